@@ -59,6 +59,9 @@ bool ArtificeShaderProgram::loadProgram(std::string pathVertex, std::string path
 	//clean up excess shader references
 	glDeleteShader( vertexShader );
 	glDeleteShader( fragmentShader );
+
+	//resolve the uniform locations once, instead of on every set
+	cacheUniforms();
 	
 	return true;
 }
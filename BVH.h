@@ -0,0 +1,403 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "Constructs3D.h"
+
+//dynamic bounding volume hierarchy (AABB tree) over the models of the level
+//leaves hold world-space bounding boxes fattened by a margin, so that models moving by small amounts only need a refit check
+//insertion picks the sibling with the least surface area cost and the tree is kept balanced with AVL-like rotations
+class BVH
+{
+	public:
+
+		static const int NULL_NODE = -1;
+
+		BVH(float margin = 0.05f) : margin(margin) {}
+
+		//inserts a model with the given world-space bounding box, returns the proxy id of its leaf
+		int insert(std::shared_ptr<model> mdl, const boundingbox& box)
+		{
+			int leaf = allocateNode();
+			nodes[leaf].box = fatten(box);
+			nodes[leaf].mdl = mdl;
+			nodes[leaf].height = 0;
+			insertLeaf(leaf);
+			return leaf;
+		}
+
+		//removes the leaf of the given proxy id
+		void remove(int proxy)
+		{
+			if (proxy < 0 || proxy >= (int)nodes.size() || !nodes[proxy].isLeaf()) return;
+			removeLeaf(proxy);
+			freeNode(proxy);
+		}
+
+		//refits the leaf of a moved model, returns true if the leaf had to be re-inserted
+		bool update(int proxy, const boundingbox& box)
+		{
+			if (proxy < 0 || proxy >= (int)nodes.size()) return false;
+			if (contains(nodes[proxy].box, box)) return false;
+			removeLeaf(proxy);
+			nodes[proxy].box = fatten(box);
+			insertLeaf(proxy);
+			return true;
+		}
+
+		//calls back for every model whose fattened bounding box overlaps the given box
+		template<typename Callback>
+		void query(const boundingbox& box, Callback callback) const
+		{
+			traverse([&](const boundingbox& b) { return overlaps(b, box); }, callback);
+		}
+
+		//calls back for every model whose fattened bounding box intersects the given sphere
+		template<typename Callback>
+		void querySphere(glm::vec3 center, float radius, Callback callback) const
+		{
+			if (radius <= 0.0f) return;
+			float radiusSquared = radius * radius;
+			traverse([&](const boundingbox& b) { return distanceSquared(b, center) <= radiusSquared; }, callback);
+		}
+
+		void clear()
+		{
+			nodes.clear();
+			root = NULL_NODE;
+			freeList = NULL_NODE;
+			leafCount = 0;
+		}
+
+		unsigned long size() const
+		{
+			return leafCount;
+		}
+
+		int height() const
+		{
+			return root == NULL_NODE ? 0 : nodes[root].height;
+		}
+
+		static bool overlaps(const boundingbox& a, const boundingbox& b)
+		{
+			return a.minX <= b.maxX && a.maxX >= b.minX &&
+				   a.minY <= b.maxY && a.maxY >= b.minY &&
+				   a.minZ <= b.maxZ && a.maxZ >= b.minZ;
+		}
+
+		static bool contains(const boundingbox& outer, const boundingbox& inner)
+		{
+			return outer.minX <= inner.minX && outer.maxX >= inner.maxX &&
+				   outer.minY <= inner.minY && outer.maxY >= inner.maxY &&
+				   outer.minZ <= inner.minZ && outer.maxZ >= inner.maxZ;
+		}
+
+		static boundingbox combine(const boundingbox& a, const boundingbox& b)
+		{
+			return { std::min(a.minX, b.minX), std::max(a.maxX, b.maxX),
+					 std::min(a.minY, b.minY), std::max(a.maxY, b.maxY),
+					 std::min(a.minZ, b.minZ), std::max(a.maxZ, b.maxZ) };
+		}
+
+		//squared distance from a point to the closest point of the box, zero if inside
+		static float distanceSquared(const boundingbox& b, glm::vec3 p)
+		{
+			float dx = std::max(std::max(b.minX - p.x, 0.0f), p.x - b.maxX);
+			float dy = std::max(std::max(b.minY - p.y, 0.0f), p.y - b.maxY);
+			float dz = std::max(std::max(b.minZ - p.z, 0.0f), p.z - b.maxZ);
+			return dx * dx + dy * dy + dz * dz;
+		}
+
+	private:
+
+		typedef struct node
+		{
+			boundingbox box;
+			std::shared_ptr<model> mdl = nullptr;
+			int parent = NULL_NODE; //doubles as the next free node when in the free list
+			int child1 = NULL_NODE;
+			int child2 = NULL_NODE;
+			int height = -1; //leaf = 0, free node = -1
+
+			bool isLeaf() const { return child1 == NULL_NODE; }
+		} node;
+
+		std::vector<node> nodes;
+		int root = NULL_NODE;
+		int freeList = NULL_NODE;
+		unsigned long leafCount = 0;
+		float margin;
+
+		template<typename Test, typename Callback>
+		void traverse(Test test, Callback callback) const
+		{
+			if (root == NULL_NODE) return;
+			std::vector<int> stack;
+			stack.reserve(64);
+			stack.push_back(root);
+			while (!stack.empty())
+			{
+				int index = stack.back();
+				stack.pop_back();
+				const node& n = nodes[index];
+				if (!test(n.box)) continue;
+				if (n.isLeaf())
+				{
+					callback(n.mdl);
+				}
+				else
+				{
+					stack.push_back(n.child1);
+					stack.push_back(n.child2);
+				}
+			}
+		}
+
+		boundingbox fatten(const boundingbox& box) const
+		{
+			return { box.minX - margin, box.maxX + margin,
+					 box.minY - margin, box.maxY + margin,
+					 box.minZ - margin, box.maxZ + margin };
+		}
+
+		//half of the surface area, used as the insertion cost
+		static float cost(const boundingbox& b)
+		{
+			float w = b.maxX - b.minX, h = b.maxY - b.minY, d = b.maxZ - b.minZ;
+			return w * h + h * d + d * w;
+		}
+
+		int allocateNode()
+		{
+			int index;
+			if (freeList == NULL_NODE)
+			{
+				nodes.push_back(node());
+				index = nodes.size() - 1;
+			}
+			else
+			{
+				index = freeList;
+				freeList = nodes[index].parent;
+				nodes[index] = node();
+			}
+			return index;
+		}
+
+		void freeNode(int index)
+		{
+			nodes[index] = node();
+			nodes[index].parent = freeList;
+			freeList = index;
+		}
+
+		void insertLeaf(int leaf)
+		{
+			leafCount++;
+			if (root == NULL_NODE)
+			{
+				root = leaf;
+				nodes[root].parent = NULL_NODE;
+				return;
+			}
+
+			//find the best sibling for the new leaf
+			boundingbox leafBox = nodes[leaf].box;
+			int index = root;
+			while (!nodes[index].isLeaf())
+			{
+				int child1 = nodes[index].child1;
+				int child2 = nodes[index].child2;
+
+				float area = cost(nodes[index].box);
+				float combinedArea = cost(combine(nodes[index].box, leafBox));
+
+				//cost of creating a new parent for this node and the new leaf
+				float siblingCost = 2.0f * combinedArea;
+				//minimum cost of pushing the leaf further down the tree
+				float inheritanceCost = 2.0f * (combinedArea - area);
+
+				float cost1 = cost(combine(leafBox, nodes[child1].box)) + inheritanceCost;
+				if (!nodes[child1].isLeaf()) cost1 -= cost(nodes[child1].box);
+				float cost2 = cost(combine(leafBox, nodes[child2].box)) + inheritanceCost;
+				if (!nodes[child2].isLeaf()) cost2 -= cost(nodes[child2].box);
+
+				if (siblingCost < cost1 && siblingCost < cost2) break;
+				index = cost1 < cost2 ? child1 : child2;
+			}
+			int sibling = index;
+
+			//create a new parent for the sibling and the leaf
+			int oldParent = nodes[sibling].parent;
+			int newParent = allocateNode();
+			nodes[newParent].parent = oldParent;
+			nodes[newParent].box = combine(leafBox, nodes[sibling].box);
+			nodes[newParent].height = nodes[sibling].height + 1;
+			if (oldParent != NULL_NODE)
+			{
+				if (nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+				else nodes[oldParent].child2 = newParent;
+			}
+			else
+			{
+				root = newParent;
+			}
+			nodes[newParent].child1 = sibling;
+			nodes[newParent].child2 = leaf;
+			nodes[sibling].parent = newParent;
+			nodes[leaf].parent = newParent;
+
+			//walk back up the tree fixing heights and boxes
+			fixUpwards(nodes[leaf].parent);
+		}
+
+		void removeLeaf(int leaf)
+		{
+			leafCount--;
+			if (leaf == root)
+			{
+				root = NULL_NODE;
+				return;
+			}
+
+			int parent = nodes[leaf].parent;
+			int grandParent = nodes[parent].parent;
+			int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+			if (grandParent != NULL_NODE)
+			{
+				//destroy parent and connect sibling to grand parent
+				if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+				else nodes[grandParent].child2 = sibling;
+				nodes[sibling].parent = grandParent;
+				freeNode(parent);
+				fixUpwards(grandParent);
+			}
+			else
+			{
+				root = sibling;
+				nodes[sibling].parent = NULL_NODE;
+				freeNode(parent);
+			}
+			nodes[leaf].parent = NULL_NODE;
+		}
+
+		void fixUpwards(int index)
+		{
+			while (index != NULL_NODE)
+			{
+				index = balance(index);
+				int child1 = nodes[index].child1;
+				int child2 = nodes[index].child2;
+				nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+				nodes[index].box = combine(nodes[child1].box, nodes[child2].box);
+				index = nodes[index].parent;
+			}
+		}
+
+		//performs a left or right rotation if node A is imbalanced, returns the new root of the subtree
+		int balance(int iA)
+		{
+			if (nodes[iA].isLeaf() || nodes[iA].height < 2) return iA;
+
+			int iB = nodes[iA].child1;
+			int iC = nodes[iA].child2;
+			int balanceFactor = nodes[iC].height - nodes[iB].height;
+
+			//rotate C up
+			if (balanceFactor > 1)
+			{
+				int iF = nodes[iC].child1;
+				int iG = nodes[iC].child2;
+
+				//swap A and C
+				nodes[iC].child1 = iA;
+				nodes[iC].parent = nodes[iA].parent;
+				nodes[iA].parent = iC;
+
+				//A's old parent should point to C
+				replaceChild(nodes[iC].parent, iA, iC);
+
+				if (nodes[iF].height > nodes[iG].height)
+				{
+					nodes[iC].child2 = iF;
+					nodes[iA].child2 = iG;
+					nodes[iG].parent = iA;
+					nodes[iA].box = combine(nodes[iB].box, nodes[iG].box);
+					nodes[iC].box = combine(nodes[iA].box, nodes[iF].box);
+					nodes[iA].height = 1 + std::max(nodes[iB].height, nodes[iG].height);
+					nodes[iC].height = 1 + std::max(nodes[iA].height, nodes[iF].height);
+				}
+				else
+				{
+					nodes[iC].child2 = iG;
+					nodes[iA].child2 = iF;
+					nodes[iF].parent = iA;
+					nodes[iA].box = combine(nodes[iB].box, nodes[iF].box);
+					nodes[iC].box = combine(nodes[iA].box, nodes[iG].box);
+					nodes[iA].height = 1 + std::max(nodes[iB].height, nodes[iF].height);
+					nodes[iC].height = 1 + std::max(nodes[iA].height, nodes[iG].height);
+				}
+				return iC;
+			}
+
+			//rotate B up
+			if (balanceFactor < -1)
+			{
+				int iD = nodes[iB].child1;
+				int iE = nodes[iB].child2;
+
+				//swap A and B
+				nodes[iB].child1 = iA;
+				nodes[iB].parent = nodes[iA].parent;
+				nodes[iA].parent = iB;
+
+				//A's old parent should point to B
+				replaceChild(nodes[iB].parent, iA, iB);
+
+				if (nodes[iD].height > nodes[iE].height)
+				{
+					nodes[iB].child2 = iD;
+					nodes[iA].child1 = iE;
+					nodes[iE].parent = iA;
+					nodes[iA].box = combine(nodes[iC].box, nodes[iE].box);
+					nodes[iB].box = combine(nodes[iA].box, nodes[iD].box);
+					nodes[iA].height = 1 + std::max(nodes[iC].height, nodes[iE].height);
+					nodes[iB].height = 1 + std::max(nodes[iA].height, nodes[iD].height);
+				}
+				else
+				{
+					nodes[iB].child2 = iE;
+					nodes[iA].child1 = iD;
+					nodes[iD].parent = iA;
+					nodes[iA].box = combine(nodes[iC].box, nodes[iD].box);
+					nodes[iB].box = combine(nodes[iA].box, nodes[iE].box);
+					nodes[iA].height = 1 + std::max(nodes[iC].height, nodes[iD].height);
+					nodes[iB].height = 1 + std::max(nodes[iA].height, nodes[iE].height);
+				}
+				return iB;
+			}
+
+			return iA;
+		}
+
+		void replaceChild(int parent, int oldChild, int newChild)
+		{
+			if (parent == NULL_NODE)
+			{
+				root = newChild;
+			}
+			else if (nodes[parent].child1 == oldChild)
+			{
+				nodes[parent].child1 = newChild;
+			}
+			else
+			{
+				nodes[parent].child2 = newChild;
+			}
+		}
+
+};
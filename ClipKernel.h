@@ -0,0 +1,210 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLIP_KERNEL_USE_SIMD
+#endif
+
+//world-space triangles laid out triangle-major as structure of arrays: x[v][t] is the x of vertex v of triangle t
+typedef struct triangleStream
+{
+	std::vector<float> x[3], y[3], z[3];
+
+	size_t size() const { return x[0].size(); }
+
+	bool empty() const { return x[0].empty(); }
+
+	void resize(size_t trisCnt)
+	{
+		for (int v = 0; v < 3; v++) { x[v].resize(trisCnt); y[v].resize(trisCnt); z[v].resize(trisCnt); }
+	}
+
+	void set(size_t t, int v, const glm::vec4& p)
+	{
+		x[v][t] = p.x; y[v][t] = p.y; z[v][t] = p.z;
+	}
+
+	glm::vec4 get(size_t t, int v) const
+	{
+		return glm::vec4(x[v][t], y[v][t], z[v][t], 1.0f);
+	}
+
+} triangleStream;
+
+
+//accumulators of the clip kernel, initialized by the caller and narrowed by the kernel
+typedef struct clipResult
+{
+	float minX = 1.0f, maxX = -1.0f; //NDC x
+	float minY = 1.0f, maxY = -1.0f; //NDC y
+	float minZ = 100000.0f, maxZ = -100000.0f; //clip z
+	float minVertexDistSq = FLT_MAX; //squared distance from the eye to the nearest vertex
+} clipResult;
+
+
+//transforms a triangle stream with a view-projection matrix, reducing the NDC bounding box, and finds the nearest vertex to the eye
+//the scalar, SSE and AVX2 variants agree up to rounding, clipTriangles() picks the widest one the CPU supports on first use
+namespace clipKernel
+{
+
+	inline void accumulateTriangle(const triangleStream& tris, size_t t, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+	{
+		for (int v = 0; v < 3; v++)
+		{
+			float x = tris.x[v][t], y = tris.y[v][t], z = tris.z[v][t];
+
+			float dx = x - eye.x, dy = y - eye.y, dz = z - eye.z;
+			r.minVertexDistSq = std::min(r.minVertexDistSq, dx * dx + dy * dy + dz * dz);
+
+			float clipX = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+			float clipY = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+			float clipZ = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+			float clipW = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+			r.minX = std::min(r.minX, clipX / clipW); r.maxX = std::max(r.maxX, clipX / clipW);
+			r.minY = std::min(r.minY, clipY / clipW); r.maxY = std::max(r.maxY, clipY / clipW);
+			r.minZ = std::min(r.minZ, clipZ); r.maxZ = std::max(r.maxZ, clipZ);
+		}
+	}
+
+	inline void clipTrianglesScalar(const triangleStream& tris, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+	{
+		for (size_t t = 0; t < tris.size(); t++) accumulateTriangle(tris, t, m, eye, r);
+	}
+
+#ifdef CLIP_KERNEL_USE_SIMD
+
+	inline void clipTrianglesSSE(const triangleStream& tris, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+	{
+		size_t count = tris.size();
+		size_t t = 0;
+		if (count >= 4)
+		{
+			__m128 mat[4][4];
+			for (int c = 0; c < 4; c++) for (int row = 0; row < 4; row++) mat[c][row] = _mm_set1_ps(m[c][row]);
+			__m128 ex = _mm_set1_ps(eye.x), ey = _mm_set1_ps(eye.y), ez = _mm_set1_ps(eye.z);
+			__m128 minX = _mm_set1_ps(r.minX), maxX = _mm_set1_ps(r.maxX);
+			__m128 minY = _mm_set1_ps(r.minY), maxY = _mm_set1_ps(r.maxY);
+			__m128 minZ = _mm_set1_ps(r.minZ), maxZ = _mm_set1_ps(r.maxZ);
+			__m128 minD = _mm_set1_ps(r.minVertexDistSq);
+
+			for (; t + 4 <= count; t += 4)
+			{
+				for (int v = 0; v < 3; v++)
+				{
+					__m128 x = _mm_loadu_ps(&tris.x[v][t]), y = _mm_loadu_ps(&tris.y[v][t]), z = _mm_loadu_ps(&tris.z[v][t]);
+
+					__m128 dx = _mm_sub_ps(x, ex), dy = _mm_sub_ps(y, ey), dz = _mm_sub_ps(z, ez);
+					minD = _mm_min_ps(minD, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+					__m128 clip[4];
+					for (int row = 0; row < 4; row++)
+					{
+						clip[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mat[0][row], x), _mm_mul_ps(mat[1][row], y)),
+											   _mm_add_ps(_mm_mul_ps(mat[2][row], z), mat[3][row]));
+					}
+					__m128 ndcX = _mm_div_ps(clip[0], clip[3]);
+					__m128 ndcY = _mm_div_ps(clip[1], clip[3]);
+					minX = _mm_min_ps(minX, ndcX); maxX = _mm_max_ps(maxX, ndcX);
+					minY = _mm_min_ps(minY, ndcY); maxY = _mm_max_ps(maxY, ndcY);
+					minZ = _mm_min_ps(minZ, clip[2]); maxZ = _mm_max_ps(maxZ, clip[2]);
+				}
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, minX); r.minX = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, maxX); r.maxX = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, minY); r.minY = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, maxY); r.maxY = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, minZ); r.minZ = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, maxZ); r.maxZ = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+			_mm_storeu_ps(lanes, minD); r.minVertexDistSq = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+		}
+		for (; t < count; t++) accumulateTriangle(tris, t, m, eye, r);
+	}
+
+	__attribute__((target("avx2,fma")))
+	inline void clipTrianglesAVX2(const triangleStream& tris, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+	{
+		size_t count = tris.size();
+		size_t t = 0;
+		if (count >= 8)
+		{
+			__m256 mat[4][4];
+			for (int c = 0; c < 4; c++) for (int row = 0; row < 4; row++) mat[c][row] = _mm256_set1_ps(m[c][row]);
+			__m256 ex = _mm256_set1_ps(eye.x), ey = _mm256_set1_ps(eye.y), ez = _mm256_set1_ps(eye.z);
+			__m256 minX = _mm256_set1_ps(r.minX), maxX = _mm256_set1_ps(r.maxX);
+			__m256 minY = _mm256_set1_ps(r.minY), maxY = _mm256_set1_ps(r.maxY);
+			__m256 minZ = _mm256_set1_ps(r.minZ), maxZ = _mm256_set1_ps(r.maxZ);
+			__m256 minD = _mm256_set1_ps(r.minVertexDistSq);
+
+			for (; t + 8 <= count; t += 8)
+			{
+				for (int v = 0; v < 3; v++)
+				{
+					__m256 x = _mm256_loadu_ps(&tris.x[v][t]), y = _mm256_loadu_ps(&tris.y[v][t]), z = _mm256_loadu_ps(&tris.z[v][t]);
+
+					__m256 dx = _mm256_sub_ps(x, ex), dy = _mm256_sub_ps(y, ey), dz = _mm256_sub_ps(z, ez);
+					minD = _mm256_min_ps(minD, _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx))));
+
+					__m256 clip[4];
+					for (int row = 0; row < 4; row++)
+					{
+						clip[row] = _mm256_fmadd_ps(mat[2][row], z, _mm256_fmadd_ps(mat[1][row], y, _mm256_fmadd_ps(mat[0][row], x, mat[3][row])));
+					}
+					__m256 ndcX = _mm256_div_ps(clip[0], clip[3]);
+					__m256 ndcY = _mm256_div_ps(clip[1], clip[3]);
+					minX = _mm256_min_ps(minX, ndcX); maxX = _mm256_max_ps(maxX, ndcX);
+					minY = _mm256_min_ps(minY, ndcY); maxY = _mm256_max_ps(maxY, ndcY);
+					minZ = _mm256_min_ps(minZ, clip[2]); maxZ = _mm256_max_ps(maxZ, clip[2]);
+				}
+			}
+
+			float lanes[7][8];
+			_mm256_storeu_ps(lanes[0], minX); _mm256_storeu_ps(lanes[1], maxX);
+			_mm256_storeu_ps(lanes[2], minY); _mm256_storeu_ps(lanes[3], maxY);
+			_mm256_storeu_ps(lanes[4], minZ); _mm256_storeu_ps(lanes[5], maxZ);
+			_mm256_storeu_ps(lanes[6], minD);
+			r.minX = *std::min_element(lanes[0], lanes[0] + 8); r.maxX = *std::max_element(lanes[1], lanes[1] + 8);
+			r.minY = *std::min_element(lanes[2], lanes[2] + 8); r.maxY = *std::max_element(lanes[3], lanes[3] + 8);
+			r.minZ = *std::min_element(lanes[4], lanes[4] + 8); r.maxZ = *std::max_element(lanes[5], lanes[5] + 8);
+			r.minVertexDistSq = *std::min_element(lanes[6], lanes[6] + 8);
+		}
+		for (; t < count; t++) accumulateTriangle(tris, t, m, eye, r);
+	}
+
+#endif
+
+	typedef void (*clipFunction)(const triangleStream&, const glm::mat4&, glm::vec3, clipResult&);
+
+	inline clipFunction selectClipFunction()
+	{
+#ifdef CLIP_KERNEL_USE_SIMD
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return clipTrianglesAVX2;
+		if (__builtin_cpu_supports("sse2")) return clipTrianglesSSE;
+#endif
+		return clipTrianglesScalar;
+	}
+
+	inline const char* selectedClipFunctionName()
+	{
+		clipFunction f = selectClipFunction();
+#ifdef CLIP_KERNEL_USE_SIMD
+		if (f == clipTrianglesAVX2) return "AVX2";
+		if (f == clipTrianglesSSE) return "SSE";
+#endif
+		return "scalar";
+	}
+
+	inline void clipTriangles(const triangleStream& tris, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+	{
+		static const clipFunction f = selectClipFunction();
+		f(tris, m, eye, r);
+	}
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include "Constructs3D.h"
+
+//box in world space with unit axes, a quad if one of its half extents is zero
+typedef struct orientedbox
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 axes[3] = { {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} };
+	glm::vec3 halfExtents = glm::vec3(0.0f);
+
+	//box of a rectangle, cuboid or cube model, from the mesh-space extents and the model matrix
+	static orientedbox fromModel(const model& m)
+	{
+		orientedbox box;
+		const boundingbox& b = m.localBBox;
+		glm::vec4 localCenter((b.minX + b.maxX) / 2.0f, (b.minY + b.maxY) / 2.0f, (b.minZ + b.maxZ) / 2.0f, 1.0f);
+		box.center = glm::vec3(m.modelMatrix * localCenter);
+		for (int i = 0; i < 3; i++) box.axes[i] = glm::normalize(glm::vec3(m.modelMatrix[i]));
+		box.halfExtents = glm::vec3((b.maxX - b.minX) / 2.0f, (b.maxY - b.minY) / 2.0f, (b.maxZ - b.minZ) / 2.0f);
+		return box;
+	}
+
+	glm::vec3 toLocal(glm::vec3 p) const
+	{
+		glm::vec3 d = p - center;
+		return glm::vec3(glm::dot(d, axes[0]), glm::dot(d, axes[1]), glm::dot(d, axes[2]));
+	}
+
+	glm::vec3 toWorldDirection(glm::vec3 v) const
+	{
+		return axes[0] * v.x + axes[1] * v.y + axes[2] * v.z;
+	}
+
+	//closest point of the box to a point, both in box space
+	glm::vec3 clampLocal(glm::vec3 p) const
+	{
+		return glm::vec3(std::clamp(p.x, -halfExtents.x, halfExtents.x),
+						 std::clamp(p.y, -halfExtents.y, halfExtents.y),
+						 std::clamp(p.z, -halfExtents.z, halfExtents.z));
+	}
+
+} orientedbox;
+
+
+//upright capsule of the person: the segment from a to b swept by a radius
+typedef struct capsule
+{
+	glm::vec3 a;
+	glm::vec3 b;
+	float radius;
+} capsule;
+
+
+typedef struct contact
+{
+	bool isTouching = false; //the capsule is closer to the box than the skin
+	glm::vec3 normal = glm::vec3(0.0f); //unit normal pointing from the box towards the capsule
+	float penetration = 0.0f; //overlap of the capsule and the box, negative if apart
+} contact;
+
+
+namespace collision
+{
+
+	//tests a capsule against an oriented box in closed form, the capsule touches the box if closer than skin
+	inline contact capsuleVsBox(const capsule& c, const orientedbox& box, float skin)
+	{
+		contact result;
+		glm::vec3 a = box.toLocal(c.a);
+		glm::vec3 ab = box.toLocal(c.b) - a;
+		const glm::vec3& h = box.halfExtents;
+
+		//clip the segment against the slabs of the box: [enter, exit] is the part of it inside the box, if any
+		float enter = 0.0f, exit = 1.0f;
+		for (int i = 0; i < 3 && enter <= exit; i++)
+		{
+			if (std::abs(ab[i]) < 1e-9f)
+			{
+				if (std::abs(a[i]) > h[i]) exit = -1.0f;
+				continue;
+			}
+			float t1 = (-h[i] - a[i]) / ab[i];
+			float t2 = (h[i] - a[i]) / ab[i];
+			enter = std::max(enter, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+		}
+
+		glm::vec3 normal(0.0f);
+		if (enter <= exit)
+		{
+			//the axis is inside the box: push out through the face the whole inside part leaves with the least depth,
+			//the part being a segment, its deepest point towards a face is one of its ends
+			glm::vec3 p0 = a + ab * enter, p1 = a + ab * exit;
+			float depth = FLT_MAX;
+			for (int i = 0; i < 3; i++)
+			{
+				float up = h[i] - std::min(p0[i], p1[i]);
+				float down = h[i] + std::max(p0[i], p1[i]);
+				if (up < depth) { depth = up; normal = glm::vec3(0.0f); normal[i] = 1.0f; }
+				if (down < depth) { depth = down; normal = glm::vec3(0.0f); normal[i] = -1.0f; }
+			}
+			result.penetration = c.radius + depth;
+		} else
+		{
+			//apart: the squared distance from the box along the segment is a quadratic between the parameters where the segment
+			//crosses the planes of the faces, each axis clamped to the same face throughout, so each piece has its minimum in closed form
+			float breaks[8] = { 0.0f };
+			int breaksCnt = 1;
+			for (int i = 0; i < 3; i++)
+			{
+				if (std::abs(ab[i]) < 1e-9f) continue;
+				for (float side : { -1.0f, 1.0f })
+				{
+					float t = (side * h[i] - a[i]) / ab[i];
+					if (t > 0.0f && t < 1.0f) breaks[breaksCnt++] = t;
+				}
+			}
+			breaks[breaksCnt++] = 1.0f;
+			std::sort(breaks, breaks + breaksCnt);
+
+			float bestT = 0.0f, bestDistSq = FLT_MAX;
+			for (int k = 0; k + 1 < breaksCnt; k++)
+			{
+				glm::vec3 mid = a + ab * ((breaks[k] + breaks[k + 1]) / 2.0f);
+				float num = 0.0f, den = 0.0f;
+				for (int i = 0; i < 3; i++)
+				{
+					if (std::abs(mid[i]) <= h[i]) continue;
+					float face = mid[i] < 0.0f ? -h[i] : h[i];
+					num += (a[i] - face) * ab[i];
+					den += ab[i] * ab[i];
+				}
+				float t = den > 0.0f ? std::clamp(-num / den, breaks[k], breaks[k + 1]) : breaks[k];
+				glm::vec3 p = a + ab * t;
+				glm::vec3 d = p - box.clampLocal(p);
+				float distSq = glm::dot(d, d);
+				if (distSq < bestDistSq) { bestDistSq = distSq; bestT = t; }
+			}
+			glm::vec3 p = a + ab * bestT;
+			glm::vec3 d = p - box.clampLocal(p);
+			float dist = glm::length(d);
+			normal = dist > 0.0f ? d / dist : glm::vec3(0.0f, 1.0f, 0.0f);
+			result.penetration = c.radius - dist;
+		}
+		result.normal = box.toWorldDirection(normal);
+		result.isTouching = result.penetration > -skin;
+		return result;
+	}
+
+}
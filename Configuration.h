@@ -10,6 +10,13 @@ typedef enum UserMode
 	EDITOR
 } UserMode;
 
+typedef enum LightingMode
+{
+	FULLSCREEN, //every pixel loops over all the lights
+	TILED, //every pixel loops over the lights binned into its screen tile
+	VOLUMES //every light is drawn as a sphere or cone covering only the pixels it can reach
+} LightingMode;
+
 typedef struct Configuration
 {
 	const std::string NAME = "Artifice";
@@ -36,6 +43,10 @@ typedef struct Configuration
 
 	bool PHONG_LIGHTING = true;
 
+	LightingMode LIGHTING_MODE = LightingMode::TILED;
+
+	unsigned int LIGHTING_TILE_SIZE = 16; //side in pixels of the screen tiles the lights are binned into
+
 	bool LIGHT_MAPPING = true;
 
 	bool NORMAL_MAPPING = true;
@@ -60,6 +71,36 @@ typedef struct Configuration
 
 	float PERSON_WIDTH = 0.05f; //horizontal colliding distance
 
+	unsigned int SIMULATION_RATE = 120; //fixed simulation steps per second
+
+	unsigned int MAX_SUBSTEPS = 5; //simulation steps to catch up with at most after a long frame, the rest is dropped
+
+	unsigned int WORKER_THREADS = 0; //threads for the parallel update, 0 sizes it to the machine
+
+	float UPDATE_TIER_NEAR = 2.0f; //models nearer to the camera are updated every tick
+
+	float UPDATE_TIER_FAR = 10.0f; //models farther from the camera are updated only after it moved to another cell
+
+	unsigned int UPDATE_TIER_INTERVAL = 3; //ticks between updates of the models in between
+
+	float UPDATE_CELL_SIZE = 2.0f; //size of the cells the camera moves through
+
+	bool OCCLUSION_CULLING = true; //skip models hidden behind the largest opaque models in view
+
+	unsigned int OCCLUSION_BUFFER_WIDTH = 256; //resolution of the software depth buffer the occluders are rasterized into
+
+	unsigned int OCCLUSION_BUFFER_HEIGHT = 128;
+
+	unsigned int OCCLUSION_OCCLUDERS = 32; //largest models on screen rasterized as occluders every tick
+
+	bool OCCLUSION_QUERIES = false; //skip drawing the cubes whose bounding box the GPU found hidden in the previous frame
+
+	bool MULTI_DRAW_INDIRECT = true; //submit the draws sharing textures and state in one call, where OpenGL 4.3 or ARB_multi_draw_indirect is there
+
+	float STATIC_CHUNK_SIZE = 8.0f; //side in world units of the chunks the models that never move are merged into per material, 0 to draw them one by one
+
+	bool PERF_STATS = false; //print performance counters about once per second
+
 	float MOUSE_SENSITIVITY_X = 1.0f;
 
 	float MOUSE_SENSITIVITY_Y = 1.0f;
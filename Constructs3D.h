@@ -4,8 +4,10 @@
 #include <SDL2/SDL_opengl.h>
 #include <GL/gl.h>
 #include "ArtificeShaderProgram.h"
+#include "ClipKernel.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
 #include <cmath>
 #include <vector>
 #include <iostream>
@@ -396,24 +398,26 @@ typedef struct boundingbox
 } boundingbox;
 
 
+//a new number for every mesh built or changed, so that copies of a model share the number of the mesh they share
+inline unsigned long nextMeshRevision()
+{
+	static std::atomic<unsigned long> revision(0);
+	return ++revision;
+}
+
 typedef struct model {
 
 	public:
 
 		unsigned long id;
-		unsigned long sn;
+		unsigned long sn; //first index of the mesh in the index buffer of its shape
+		unsigned long baseVertex = 0; //first vertex of the mesh in the vertex buffer of its shape, the indices count from it
 		std::string texture;
 		glm::vec3 position;
 		bool isSolid = true;
 		mesh modelMesh;
 
-		bool inFocus = false;
-		float distance;
-		bool isInDOF = true;
-		bool isInFOV = true;
 		bool removeFlag = false;
-		bool isCovered = false;
-		boundingbox bbox;
 		glm::mat4 modelMatrix = glm::mat4(1.0f);
 		glm::mat4 rotationMatrix = glm::mat4(1.0f);
 
@@ -423,9 +427,16 @@ typedef struct model {
 
 		float speed = 0.0f;
 		glm::vec3 front = glm::vec3(0.0, 1.0, 0.0);
-		float highestY = 0.0f;
-		float lowestY = 0.0f;
-		unsigned long ignoreForCycles = 0;
+
+		boundingbox localBBox; //mesh-space bounding box, the box or quad tested for collision
+		boundingbox worldBBox; //world-space bounding box, kept in the BVH
+		int handle = -1; //index of the per-frame state in the ModelStore, -1 if not registered
+		unsigned long meshRevision = nextMeshRevision(); //changes with the triangles, the vertex arena uploads them again then
+		glm::vec3 scaledDimensions = glm::vec3(-1.0f); //width, height and depth the mesh was last built with by scale(), negative until then
+
+		//world-space cache, recomputed by refresh() only when position, rotation or scale changed
+		bool isDirty = true;
+		triangleStream worldTris;
 
 		model() {}
 
@@ -440,54 +451,62 @@ typedef struct model {
 			rotationMatrix = shape.rotationMatrix;
 		}
 
-		virtual void render(ArtificeShaderProgram* geometryShader, GLuint gVAO, GLuint gIBO, GLuint textureId, GLuint lightmapId, GLuint normalmapId, GLuint displacementmapId)
-		{
-			if (modelMesh.shape == shapetype::RECTANGLE && glIsEnabled(GL_CULL_FACE)) {
-				glDisable(GL_CULL_FACE);
-			}
-			// std::cout << "rendering model" << std::endl;
-			geometryShader->bind();
-			geometryShader->setInt("material.diffuseTexture", 0);
-			geometryShader->setInt("material.lightmap", 1);
-			geometryShader->setInt("material.normalmap", 2);
-			geometryShader->setInt("material.displacementmap", 3);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, textureId);
-			
-			geometryShader->setBool("material.existsLightmap", lightmapId > 0);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, lightmapId);
-
-			geometryShader->setBool("material.existsNormalmap", normalmapId > 0);
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, normalmapId);
-
-			geometryShader->setBool("material.existsDisplacementmap", displacementmapId > 0);
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_2D, displacementmapId);
-
-			geometryShader->setMat4("model", this->modelMatrix);
-			geometryShader->setInt("frameIndex", this->frameIndex);
-			geometryShader->setInt("frameRows", this->frameRows);
-			geometryShader->setInt("frameCols", this->frameCols);
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIBO);
-			glBindVertexArray(gVAO);
-			glDrawElements(GL_TRIANGLES, this->modelMesh.tris.size() * 3, GL_UNSIGNED_INT, (void*)(( this->sn ) * sizeof(GL_UNSIGNED_INT)));
-			glBindVertexArray(0);
-			if (modelMesh.shape == shapetype::RECTANGLE && !glIsEnabled(GL_CULL_FACE)) {
-				glEnable(GL_CULL_FACE);
-			}
-		}
-
 		void rotate(float thetaRotationX, float thetaRotationY, float thetaRotationZ) {
 			rotationMatrix = glm::mat4(1.0f);
 			rotationMatrix = glm::rotate(rotationMatrix, thetaRotationX, glm::vec3(1.0f, 0.0f, 0.0f));
 			rotationMatrix = glm::rotate(rotationMatrix, thetaRotationY, glm::vec3(0.0f, 1.0f, 0.0f));
 			rotationMatrix = glm::rotate(rotationMatrix, thetaRotationZ, glm::vec3(0.0f, 0.0f, 1.0f));
+			isDirty = true;
+		}
+
+		void updateModelMatrix() {
+			modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, position);
+			modelMatrix = modelMatrix * rotationMatrix;
+		}
+
+		void setPosition(glm::vec3 pos) {
+			position = pos;
+			isDirty = true;
+		}
+
+		void markDirty() {
+			isDirty = true;
+		}
+
+		//recomputes the cached world-space vertices and the bounding boxes if dirty, returns true if recomputed
+		bool refresh() {
+			if (!isDirty) return false;
+			updateModelMatrix();
+			worldTris.resize(modelMesh.tris.size());
+			localBBox = boundingbox();
+			worldBBox = { position.x, position.x, position.y, position.y, position.z, position.z };
+			if (!modelMesh.tris.empty()) {
+				glm::vec4 first = modelMesh.tris[0].p[0];
+				localBBox = { first.x, first.x, first.y, first.y, first.z, first.z };
+				first = modelMatrix * first;
+				worldBBox = { first.x, first.x, first.y, first.y, first.z, first.z };
+			}
+			for (size_t t = 0; t < modelMesh.tris.size(); t++) {
+				for (int i = 0; i < 3; i++) {
+					const glm::vec4& local = modelMesh.tris[t].p[i];
+					localBBox.minX = std::min(localBBox.minX, local.x); localBBox.maxX = std::max(localBBox.maxX, local.x);
+					localBBox.minY = std::min(localBBox.minY, local.y); localBBox.maxY = std::max(localBBox.maxY, local.y);
+					localBBox.minZ = std::min(localBBox.minZ, local.z); localBBox.maxZ = std::max(localBBox.maxZ, local.z);
+					glm::vec4 pt = modelMatrix * local;
+					worldTris.set(t, i, pt);
+					worldBBox.minX = std::min(worldBBox.minX, pt.x); worldBBox.maxX = std::max(worldBBox.maxX, pt.x);
+					worldBBox.minY = std::min(worldBBox.minY, pt.y); worldBBox.maxY = std::max(worldBBox.maxY, pt.y);
+					worldBBox.minZ = std::min(worldBBox.minZ, pt.z); worldBBox.maxZ = std::max(worldBBox.maxZ, pt.z);
+				}
+			}
+			isDirty = false;
+			return true;
 		}
 
+		//builds the mesh again with the given dimensions, unless it already has them: the editor scales the model being placed every tick
 		virtual void scale(float width, float height, float depth) {
+			if (!changesScale(width, height, depth)) return;
 			if (modelMesh.shape == shapetype::RECTANGLE) {
 				rectangle rectangle(width, height, 0.0f, 0.0f, 0.0f);
 				modelMesh.tris = rectangle.triangles;
@@ -495,6 +514,16 @@ typedef struct model {
 				cuboid cuboid(width, height, depth, 0.0f, 0.0f, 0.0f);
 				modelMesh.tris = cuboid.triangles;
 			}
+			meshRevision = nextMeshRevision();
+			isDirty = true;
+		}
+
+		//true if the dimensions differ from the ones the mesh was last built with, which they then replace
+		bool changesScale(float width, float height, float depth) {
+			glm::vec3 dimensions(width, height, depth);
+			if (dimensions == scaledDimensions) return false;
+			scaledDimensions = dimensions;
+			return true;
 		}
 
 		float getWidth() {
@@ -570,37 +599,12 @@ typedef struct cubeModel : public model {
 
 		cubeModel(model& m) : model(m) {}
 
-		void render(ArtificeShaderProgram* geometryShader, GLuint gCubeVAO, GLuint gCubeIBO, GLuint textureId, GLuint lightmapId, GLuint normalmapId, GLuint displacementmapId) override
-		{
-			//std::cout << "rendering cubeModel" << std::endl;
-			geometryShader->setInt("material.diffuseTexture", 0);
-			geometryShader->setInt("material.lightmap", 1);
-			geometryShader->setInt("material.normalmap", 2);
-			geometryShader->setInt("material.displacementmap", 3);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
-
-			geometryShader->setBool("material.existsLightmap", lightmapId > 0);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, lightmapId);
-
-			geometryShader->setBool("material.existsNormalmap", normalmapId > 0);
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, normalmapId);
-
-			geometryShader->setBool("material.existsDisplacementmap", displacementmapId > 0);
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, displacementmapId);
-
-			if (!isSkyBox) { geometryShader->setMat4("model", this->modelMatrix); }
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gCubeIBO);
-			glBindVertexArray(gCubeVAO);
-			glDrawElements(GL_TRIANGLES, this->modelMesh.tris.size() * 3, GL_UNSIGNED_INT, (void*)((this->sn) * sizeof(GL_UNSIGNED_INT)));
-		}
-
 		virtual void scale(float width, float height, float depth) {
+			if (!changesScale(width, height, depth)) return;
 			cube cube(std::max(width, std::max(height, depth)), 0.0f, 0.0f, 0.0f);
 			modelMesh.tris = cube.triangles;
+			meshRevision = nextMeshRevision();
+			isDirty = true;
 		}
 
 		virtual ~cubeModel() {}
@@ -2,6 +2,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+//names of the per-tier counters of the update scheduler
+static const char* tierModelsCounters[UPDATE_TIERS_CNT] = { "models every tick", "models every interval", "models on cell change" };
+static const char* tierUpdatesCounters[UPDATE_TIERS_CNT] = { "updates every tick", "updates every interval", "updates on cell change" };
+
 Engine3D::Engine3D(
 					SDL_Window* gWindow, Camera cam,
 					int width, int height,
@@ -35,6 +39,14 @@ Engine3D::Engine3D(
 
 	projectionMatrix = glm::perspective(glm::radians((float)fov), (float)width / (float)height, near, far);
 
+	simulationStep = 1.0f / std::max(1u, cfg.SIMULATION_RATE);
+
+	threadPool = std::make_unique<ThreadPool>(cfg.WORKER_THREADS);
+	occlusionBuffer = std::make_unique<OcclusionBuffer>(cfg.OCCLUSION_BUFFER_WIDTH, cfg.OCCLUSION_BUFFER_HEIGHT, threadPool->size() * 2);
+	lightTiles = LightTileGrid(width, height, cfg.LIGHTING_TILE_SIZE);
+	staticChunks = StaticChunks(cfg.STATIC_CHUNK_SIZE);
+	updateScheduler = UpdateScheduler(cfg.UPDATE_TIER_NEAR, cfg.UPDATE_TIER_FAR, cfg.UPDATE_TIER_INTERVAL, cfg.UPDATE_CELL_SIZE);
+
 	if (userMode == UserMode::EDITOR)
 	{
 		this->gravitationalPull = 0.0f;
@@ -103,24 +115,168 @@ void Engine3D::engineLoop()
 
 	renderingThread = startRendering();
 
-	auto tp1 = std::chrono::system_clock::now();
-	auto tp2 = std::chrono::system_clock::now();
+	//fixed timestep: the simulation advances in steps of 1 / SIMULATION_RATE seconds, sleeping in between
+	typedef std::chrono::steady_clock steadyClock;
+	const std::chrono::duration<double> step(simulationStep);
+	std::chrono::duration<double> accumulator(0.0);
+	auto tp1 = steadyClock::now();
 
-	//run as fast as possible
 	while (isActive)
 	{
 		//handle timing
-		tp2 = std::chrono::system_clock::now();
-		std::chrono::duration<float> elapsedTimeDuration = tp2 - tp1;
+		auto tp2 = steadyClock::now();
+		accumulator += tp2 - tp1;
 		tp1 = tp2;
-		elapsedTime = elapsedTimeDuration.count();
 
-		//handle frame update
-		if (!update(elapsedTime))
-			isActive = false;
+		//handle frame updates, catching up with at most MAX_SUBSTEPS steps after a long frame
+		unsigned int substeps = 0;
+		while (isActive && accumulator >= step && substeps < std::max(1u, cfg.MAX_SUBSTEPS))
+		{
+			elapsedTime = simulationStep;
+			if (!update(elapsedTime))
+				isActive = false;
+			accumulator -= step;
+			substeps++;
+		}
+		//drop the time that could not be caught up with, so that a long stall does not make the simulation spiral
+		if (accumulator >= step) accumulator = std::chrono::duration<double>(std::fmod(accumulator.count(), step.count()));
+
+		//sleep until the next step is due
+		std::this_thread::sleep_until(tp1 + std::chrono::duration_cast<steadyClock::duration>(step - accumulator));
+	}
+}
+
+void Engine3D::publishSnapshot()
+{
+	//the draws carry the ids of their materials, which are known once the rendering thread has loaded them
+	if (!areTexturesLoaded) return;
+	sceneSnapshot& snapshot = snapshots.writeSlot();
+	snapshot.tick = updateTick;
+
+	//copy what is drawn of the models to render, so that the rendering thread never reads the models themselves
+	//the models whose meshes are not in the arenas yet wait for the next update of the vertices, their ranges would point elsewhere
+	snapshot.cubeItems.clear();
+	snapshot.items.clear();
+	snapshot.hasSkyBox = false;
+	for (auto &ptrModel : finalCubeModelsToRender)
+	{
+		if (!ptrModel || ptrModel->removeFlag || !cubeArena.isUploaded(*ptrModel)) continue;
+		int h = ptrModel->handle;
+		if (modelStore.isSkyBox[h])
+		{
+			if (std::static_pointer_cast<cubeModel>(ptrModel)->isActiveSkyBox)
+			{
+				snapshot.skyBox = drawItem(*ptrModel, 0.0f, true);
+				resolveMaterial(snapshot.skyBox, *ptrModel);
+				snapshot.hasSkyBox = true;
+			}
+			continue;
+		}
+		snapshot.cubeItems.emplace_back(*ptrModel, modelStore.distance[h]);
+		resolveMaterial(snapshot.cubeItems.back(), *ptrModel);
+	}
+	for (auto &ptrModel : finalModelsToRender)
+	{
+		//the models merged into chunks are drawn with their chunks
+		if (!ptrModel || ptrModel->removeFlag || staticChunks.isMerged(ptrModel.get()) || !modelArena.isUploaded(*ptrModel)) continue;
+		snapshot.items.emplace_back(*ptrModel, modelStore.distance[ptrModel->handle]);
+		resolveMaterial(snapshot.items.back(), *ptrModel);
+	}
+
+	snapshot.cubeArenaGeneration = cubeArena.getGeneration();
+	snapshot.modelArenaGeneration = modelArena.getGeneration();
+
+	snapshot.projectionMatrix = projectionMatrix;
+	snapshot.camera.position = cameraPos;
+	snapshot.camera.front = cameraFront;
+	snapshot.camera.up = cameraUp;
+	snapshot.prevCamera = updateTick > 1 ? prevCameraState : snapshot.camera;
+	prevCameraState = snapshot.camera;
+	snapshot.time = std::chrono::steady_clock::now();
+
+	snapshot.personPos = getPersonPos();
+	snapshot.personFront = getPersonFront();
+	snapshot.isFlashLightOn = isFlashLightOn;
+
+	//the lights change only while editing, so the snapshots share one copy until then
+	if (lightsDirty || !publishedLights)
+	{
+		std::shared_ptr<lightSet> lights = std::make_shared<lightSet>();
+		lights->light = light;
+		lights->pointLights = pointLights;
+		lights->spotLights = spotLights;
+		lights->flashLight = flashLight;
+		lights->assignedFlashLight = assignedFlashLight;
+		publishedLights = lights;
+		lightsDirty = false;
+	}
+	snapshot.lights = publishedLights;
+
+	if (snapshots.publish()) updateStats.add("overwritten snapshots");
+}
+
+void Engine3D::resolveMaterial(drawItem& item, const model& m) const
+{
+	if (m.modelMesh.shape == shapetype::CUBE)
+	{
+		auto itr = cubemapSetIds.find(m.texture);
+		item.textureSet = itr == cubemapSetIds.end() ? 0 : itr->second;
+		return;
+	}
+	const TextureArrays::material& mat = textureArrays.get(m.texture);
+	item.textureSet = mat.set;
+	item.layer = mat.layer;
+	item.maps = mat.maps;
+	item.isTransparent = transparentTextures.count(m.texture) > 0;
+}
+
+const Engine3D::cubemapSet& Engine3D::getCubemapSet(GLuint id) const
+{
+	return id > 0 && id <= cubemapSets.size() ? cubemapSets[id - 1] : noCubemaps;
+}
+
+void Engine3D::relocateItems(sceneSnapshot& snapshot)
+{
+	auto relocate = [](const VertexArena& arena, std::vector<drawItem>& items) {
+		items.erase(std::remove_if(items.begin(), items.end(), [&arena](drawItem& item) {
+			return !arena.locate(item.source, item.meshRevision, item.firstIndex, item.baseVertex);
+		}), items.end());
+	};
+	if (snapshot.cubeArenaGeneration != cubeArena.getGeneration())
+	{
+		relocate(cubeArena, snapshot.cubeItems);
+		if (snapshot.hasSkyBox) snapshot.hasSkyBox = cubeArena.locate(snapshot.skyBox.source, snapshot.skyBox.meshRevision, snapshot.skyBox.firstIndex, snapshot.skyBox.baseVertex);
+		snapshot.cubeArenaGeneration = cubeArena.getGeneration();
+		renderStats.add("relocated snapshots");
+	}
+	if (snapshot.modelArenaGeneration != modelArena.getGeneration())
+	{
+		relocate(modelArena, snapshot.items);
+		snapshot.modelArenaGeneration = modelArena.getGeneration();
+		renderStats.add("relocated snapshots");
 	}
 }
 
+void Engine3D::interpolateCameraState(const sceneSnapshot& snapshot)
+{
+	const cameraState& prev = snapshot.prevCamera;
+	const cameraState& curr = snapshot.camera;
+	//the frame shows the camera between the last two steps, as far as the time since the last one is into a step
+	std::chrono::duration<float> sinceStep = std::chrono::steady_clock::now() - snapshot.time;
+	float alpha = std::clamp(sinceStep.count() / simulationStep, 0.0f, 1.0f);
+	glm::vec3 front = glm::mix(prev.front, curr.front, alpha);
+	if (glm::length(front) < 0.0001f) front = curr.front;
+	renderCameraPos = glm::mix(prev.position, curr.position, alpha);
+	renderViewMatrix = glm::lookAt(renderCameraPos, renderCameraPos + glm::normalize(front), glm::normalize(glm::mix(prev.up, curr.up, alpha)));
+}
+
+void Engine3D::lockCounted(PerfStats& stats)
+{
+	if (mtx.try_lock()) return;
+	stats.add("mutex waits");
+	mtx.lock();
+}
+
 std::thread Engine3D::startRendering()
 {
 	//start thread
@@ -156,6 +312,8 @@ void Engine3D::renderingLoop()
 			printf( "Error initializing GLEW! %s\n", glewGetErrorString( glewError ) );
 			return;
 		}
+		isIndirectDrawing = cfg.MULTI_DRAW_INDIRECT && IndirectDrawBuffer::isSupported();
+		printf( isIndirectDrawing ? "Drawing with multi-draw indirect\n" : "Drawing batch by batch\n" );
 		//initialize OpenGL
 		printf( "Initializing OpenGL shaders, arrays, buffers, textures, cubemaps...\n" );
 		if( !initGL() )
@@ -174,7 +332,16 @@ void Engine3D::renderingLoop()
 	while (isActive)
 	{
 		render();
+		if (cfg.PERF_STATS) renderStats.tick();
 	}
+
+	lightBuffer.free();
+	lightTiles.free();
+	lightVolumes.free();
+	instanceBuffer.free();
+	staticChunks.free();
+	textureArrays.free();
+	indirectBuffer.free();
 }
 
 bool Engine3D::initGL()
@@ -197,11 +364,21 @@ bool Engine3D::initGL()
 		printf( "Unable to load geometry skybox shader!\n" );
 		success = false;
 	}
+	else if(!occlusionShader.loadProgram("shaders/occlusion.glvs", "shaders/occlusion.glfs"))
+	{
+		printf( "Unable to load occlusion shader!\n" );
+		success = false;
+	}
 	else if(!lightingShader.loadProgram("shaders/lighting.glvs", "shaders/lighting.glfs"))
 	{
 		printf( "Unable to load lighting shader!\n" );
 		success = false;
 	}
+	else if(!lightVolumeShader.loadProgram("shaders/lightVolume.glvs", "shaders/lightVolume.glfs"))
+	{
+		printf( "Unable to load light volume shader!\n" );
+		success = false;
+	}
 	else if(!postProcShader.loadProgram("shaders/postproc.glvs", "shaders/postproc.glfs"))
 	{
 		printf( "Unable to load post-processing shader!\n" );
@@ -215,38 +392,58 @@ bool Engine3D::initGL()
 		gGeometryProgramID = geometryShader.getProgramID();
 		gGeometryCubemapProgramID = geometryCubemapShader.getProgramID();
 		gGeometrySkyboxProgramID = geometrySkyboxShader.getProgramID();
+		gOcclusionProgramID = occlusionShader.getProgramID();
 		gLightingProgramID = lightingShader.getProgramID();
+		gLightVolumeProgramID = lightVolumeShader.getProgramID();
 		gPostProcProgramID = postProcShader.getProgramID();
 
+		geometryShaderUniforms.resolve(geometryShader);
+		geometryCubemapShaderUniforms.resolve(geometryCubemapShader);
+		geometrySkyboxShaderUniforms.resolve(geometrySkyboxShader);
+		flashLightUniforms = resolveSpotLightUniforms("flashLight");
+
+		//the samplers keep their texture units for the life of the programs, so they are set once here and not every frame
 		geometryShader.bind();
 		geometryShader.setInt("userMode", (int)cfg.USER_MODE);
+		setMaterialSamplers(geometryShader);
 		geometryShader.unbind();
 
 		geometryCubemapShader.bind();
 		geometryCubemapShader.setInt("userMode", (int)cfg.USER_MODE);
+		setMaterialSamplers(geometryCubemapShader);
 		geometryCubemapShader.unbind();
 
+		geometrySkyboxShader.bind();
+		setMaterialSamplers(geometrySkyboxShader);
+		geometrySkyboxShader.unbind();
+
 		lightingShader.bind();
 		lightingShader.setBool("phongLighting", cfg.PHONG_LIGHTING);
+		setGBufferSamplers(lightingShader);
+		lightingShader.setInt("pointLightsData", 5);
+		lightingShader.setInt("spotLightsData", 6);
+		lightingShader.setInt("lightTiles", 7);
+		lightingShader.setInt("lightIndices", 8);
 		lightingShader.unbind();
 
+		lightVolumeShader.bind();
+		setGBufferSamplers(lightVolumeShader);
+		lightVolumeShader.setInt("lightsData", 5);
+		lightVolumeShader.unbind();
+
+		if (cfg.LIGHTING_MODE == LightingMode::VOLUMES) lightVolumes.init();
+
 		postProcShader.bind();
 		postProcShader.setInt("SCREEN_WIDTH", cfg.SCREEN_WIDTH);
 		postProcShader.setInt("SCREEN_HEIGHT", cfg.SCREEN_HEIGHT);
 		postProcShader.setBool("isFXAAOn", cfg.FXAA);
+		postProcShader.setInt("screenTexture", 0);
 		postProcShader.unbind();
 		
-		//create VAOs
-		glGenVertexArrays(1, &gVAO);
-		glGenVertexArrays(1, &gCubeVAO);
-
-		//create VBOs
-		glGenBuffers( 1, &gVBO );
-		glGenBuffers( 1, &gCubeVBO );
-
-		//create IBO
-		glGenBuffers( 1, &gIBO );
-		glGenBuffers( 1, &gCubeIBO );
+		//create VAOs and their buffers
+		modelArena.init();
+		cubeArena.init();
+		staticChunks.init();
 
 		//update buffers with the new vertices
 		updateVertices();
@@ -380,6 +577,9 @@ bool Engine3D::initGL()
 		unsigned int attachmentsLighting[1] = { GL_COLOR_ATTACHMENT0 };
 		glDrawBuffers(1, attachmentsLighting);
 
+		//the depth of the geometry pass, for the light volumes to be tested against, it is not written in the lighting pass
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderBO);
+
 		//finally check if framebuffer is complete
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 			std::cout << "Lighting framebuffer not complete!" << std::endl;
@@ -389,37 +589,52 @@ bool Engine3D::initGL()
 		//initialize clear color
 		glClearColor( 0.f, 0.f, 0.f, 1.f );
 
-		//generates and binds textures, lightmaps, normalmaps and parallax maps (displacementmaps)
-		loadTextures(textureIdsMap, lightmapIdsMap, normalmapIdsMap, displacementmapIdsMap);
+		//generates the texture arrays of the textures, lightmaps, normalmaps and parallax maps (displacementmaps)
+		loadTextures();
 
-		for (std::pair<const std::string, GLuint>& entry : textureIdsMap )
+		for (std::pair<const std::string, bool>& entry : textureTransparencyMap)
 		{
-			textureNames.push_back(entry.first);
+			if (entry.second) transparentTextures.insert(entry.first);
 		}
 
+		textureNames = textureArrays.getNames();
+
 		//generates and binds cubemaps, skyboxes, cube lightmaps, cube normalmaps and cube parallaxmaps (displacementmaps)
 		loadCubemaps(cubemapIdsMap, cubeLightmapIdsMap, cubeNormalmapIdsMap, cubeDisplacementmapIdsMap);
 
+		auto idOf = [](const std::map<std::string, GLuint>& idsMap, const std::string& name) {
+			auto itr = idsMap.find(name);
+			return itr == idsMap.end() ? 0 : itr->second;
+		};
 		for (std::pair<const std::string, GLuint>& entry : cubemapIdsMap )
 		{
 			cubemapNames.push_back(entry.first);
+			cubemapSet c;
+			c.texture = entry.second;
+			c.lightmap = idOf(cubeLightmapIdsMap, entry.first);
+			c.normalmap = idOf(cubeNormalmapIdsMap, entry.first);
+			c.displacementmap = idOf(cubeDisplacementmapIdsMap, entry.first);
+			cubemapSets.push_back(c);
+			cubemapSetIds[entry.first] = (GLuint)cubemapSets.size();
 		}
+		//the engine thread resolves the materials of the draws from here on
+		areTexturesLoaded = true;
 		
 	}
 	return success;
 }
 
-void Engine3D::loadTextures(std::map<std::string, GLuint>& textureIdsMap, std::map<std::string, GLuint>& lightmapIdsMap, std::map<std::string, GLuint>& normalmapIdsMap, std::map<std::string, GLuint>& displacementmapIdsMap)
+void Engine3D::loadTextures()
 {
 	std::string textureDirNames[4] = {std::string("textures"), std::string("lightmaps"), std::string("normalmaps"), std::string("displacementmaps")};
 	std::string filename;
 	unsigned short i = 0;
-	std::map<std::string, GLuint>* idsMap;
+	TextureArrays::mapKind kind;
 	for (std::string textureDirName : textureDirNames) {
-		if (++i==2)    { if (!cfg.LIGHT_MAPPING)        { continue; } idsMap = &lightmapIdsMap; }
-		else if (i==3) { if (!cfg.NORMAL_MAPPING)       { continue; } idsMap = &normalmapIdsMap; }
-		else if (i==4) { if (!cfg.DISPLACEMENT_MAPPING) { continue; } idsMap = &displacementmapIdsMap; }
-		else { idsMap = &textureIdsMap; }
+		if (++i==2)    { if (!cfg.LIGHT_MAPPING)        { continue; } kind = TextureArrays::LIGHTMAP; }
+		else if (i==3) { if (!cfg.NORMAL_MAPPING)       { continue; } kind = TextureArrays::NORMALMAP; }
+		else if (i==4) { if (!cfg.DISPLACEMENT_MAPPING) { continue; } kind = TextureArrays::DISPLACEMENTMAP; }
+		else { kind = TextureArrays::DIFFUSE; }
 		std::string texturesPath = cfg.ASSETS_PATH + cfg.PATH_SEP + textureDirName;
 		for (const auto & entry : std::filesystem::directory_iterator(texturesPath))
 		{
@@ -431,48 +646,27 @@ void Engine3D::loadTextures(std::map<std::string, GLuint>& textureIdsMap, std::m
 					filename = entry.path().filename().string();
 				}
 
-				//declare texture
-				glGenTextures(1, &(*idsMap)[filename]);
-				//std::cout << filename << ": " << (*idsMap)[filename] << std::endl;
-				//bind texture
-				glBindTexture(GL_TEXTURE_2D, (*idsMap)[filename]);
-
-				//load image
+				//load image, as RGB whatever its channels, so that the images of the same size fit in one array
 				int width, height, nrChannels;
-				unsigned char *data = stbi_load(entry.path().string().c_str(), &width, &height, &nrChannels, 0);
-				// if first pixel is pure magenta, then texture is considered to have transparency
-				bool hasTransparency = (int)data[0] == 255 && (int)data[1] == 0 && (int)data[2] == 255;
-				textureTransparencyMap[filename] = hasTransparency;
+				unsigned char *data = stbi_load(entry.path().string().c_str(), &width, &height, &nrChannels, 3);
 				if (data)
 				{
-					//generate texture
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-					glGenerateMipmap(GL_TEXTURE_2D);
+					// if first pixel of a texture is pure magenta, then it is considered to have transparency
+					bool hasTransparency = (int)data[0] == 255 && (int)data[1] == 0 && (int)data[2] == 255;
+					if (kind == TextureArrays::DIFFUSE) textureTransparencyMap[filename] = hasTransparency;
+					textureArrays.add(kind, filename, width, height, data, hasTransparency);
 				} else {
 					std::cout << "Failed to load " << filename << " from path: " << texturesPath << std::endl;
 				}
 
 				//free image memory
 				stbi_image_free(data);
-
-				//set the texture wrapping/filtering options (on the currently bound texture object)
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-				if (hasTransparency) { //to achieve transparency
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-				} else { //filter texture
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				}
 			}
 		}
 	}
-	//activate shader
-	geometryShader.bind();
-	//set the uniforms
-	geometryShader.setInt("frameIndex", 0);
-	geometryShader.unbind();
+
+	//gather the maps of the same sizes and filtering into arrays, one layer per material
+	textureArrays.build();
 }
 
 void Engine3D::loadCubemaps(std::map<std::string, GLuint>& cubemapIdsMap, std::map<std::string, GLuint>& cubeLightmapIdsMap, std::map<std::string, GLuint>& cubeNormalmapIdsMap, std::map<std::string, GLuint>& cubeDisplacementmapIdsMap)
@@ -571,32 +765,44 @@ void Engine3D::renderScreenQuad()
 		// setup plane VAO
 		glGenVertexArrays(1, &scrQuadVAO);
 		glGenBuffers(1, &scrQuadVBO);
-		glBindVertexArray(scrQuadVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, scrQuadVBO);
+		glState.bindVertexArray(scrQuadVAO);
+		glState.bindArrayBuffer(scrQuadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	}
-	glBindVertexArray(scrQuadVAO);
+	glState.bindVertexArray(scrQuadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
 void Engine3D::render()
 {
-	glDisable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-	if (updateVerticesFlag) updateVertices();
+	if (updateVerticesFlag)
+	{
+		lockCounted(renderStats);
+		updateVertices();
+		mtx.unlock();
+	}
+	glState.setEnabled(GL_BLEND, false);
+	glState.setEnabled(GL_DEPTH_TEST, true);
+	setCullFace(true);
+
+	//take the latest snapshot of the scene, or draw the previous one again if the engine has not published a new one yet
+	if (!snapshots.consume()) renderStats.add("stale snapshots");
+	sceneSnapshot& snapshot = snapshots.readSlot();
+	if (!snapshot.lights) return;
+	relocateItems(snapshot);
+	const lightSet& lights = *snapshot.lights;
+	interpolateCameraState(snapshot);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	//clear color buffer
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//geometry pass: write geometry to the multisampling buffer or the regular one
 	if (cfg.MSAA && cfg.MSAA_SAMPLES > 1) {
-		glEnable(GL_MULTISAMPLE);
+		glState.setEnabled(GL_MULTISAMPLE, true);
 		glBindFramebuffer(GL_FRAMEBUFFER, gBOMS);
 	} else {
 		glBindFramebuffer(GL_FRAMEBUFFER, gBO);
@@ -604,77 +810,101 @@ void Engine3D::render()
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//render skybox
-	glDepthMask(GL_FALSE);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_FRONT);
-	geometrySkyboxShader.bind();
-	geometrySkyboxShader.setMat4("projection", getProjectionMatrix());
-	geometrySkyboxShader.setMat4("view", getViewMatrixNoTranslation());
-	if (finalSkyBoxToRender != nullptr)
+	glState.depthMask(false);
+	glState.depthFunc(GL_LEQUAL);
+	glState.cullFace(GL_FRONT);
+	glState.useProgram(gGeometrySkyboxProgramID);
+	geometrySkyboxShader.setMat4("projection", snapshot.projectionMatrix);
+	geometrySkyboxShader.setMat4("view", glm::mat4(glm::mat3(renderViewMatrix)));
+	if (snapshot.hasSkyBox)
 	{
-		cubeModel& cm = *finalSkyBoxToRender;
-		cm.render(&geometrySkyboxShader, gCubeVAO, gCubeIBO, cubemapIdsMap[cm.texture], 0, 0, 0);
+		snapshot.skyBox.render(glState, &geometrySkyboxShader, geometrySkyboxShaderUniforms, cubeArena.getVertexArray(), cubeArena.getIndexBuffer(), getCubemapSet(snapshot.skyBox.textureSet).texture, 0, 0, 0);
 	}
-	geometrySkyboxShader.unbind();
 
-	glCullFace(GL_BACK);
+	glState.cullFace(GL_BACK);
 
 	//render cubemaps
-	glDepthMask(GL_TRUE);
-	glDepthFunc(GL_LESS);
-	geometryCubemapShader.bind();
-	geometryCubemapShader.setMat4("projection", getProjectionMatrix());
-	geometryCubemapShader.setMat4("view", getViewMatrix());
-	geometryCubemapShader.setVec3("viewPos", getCameraPos());
-	mtx.lock();
-	for (auto itr = finalCubeModelsToRender.begin(); itr != finalCubeModelsToRender.end(); itr++)
+	glState.depthMask(true);
+	glState.depthFunc(GL_LESS);
+	glState.useProgram(gGeometryCubemapProgramID);
+	geometryCubemapShader.setMat4("projection", snapshot.projectionMatrix);
+	geometryCubemapShader.setMat4("view", renderViewMatrix);
+	geometryCubemapShader.setVec3("viewPos", renderCameraPos);
+	renderFrame++;
+
+	//queue the draws under keys that put the ones sharing state next to each other, then group them into instanced draws
+	renderQueue.clear();
+	for (const drawItem& item : snapshot.cubeItems)
 	{
-		if (!(*itr)) { std::cout << "nullptr!" << std::endl; continue; }
-		
-		cubeModel& cm = dynamic_cast<cubeModel &>(*(*itr));
-				
-		if (cm.removeFlag) continue;
-
-		if (cm.isSkyBox) {
-			if (cm.isActiveSkyBox)
-			{
-				finalSkyBoxToRender = std::make_shared<cubeModel>(cm);
-			}
-			continue;
-		}
-		cm.render(&geometryCubemapShader, gCubeVAO, gCubeIBO, cubemapIdsMap[cm.texture], cubeLightmapIdsMap[cm.texture], cubeNormalmapIdsMap[cm.texture], cubeDisplacementmapIdsMap[cm.texture]);
+		//cubes with a query are drawn on their own below, under conditional rendering
+		if (cfg.OCCLUSION_QUERIES && isQueried(item.id)) continue;
+		renderQueue.push(RenderQueue::CUBE_PASS, item, item.textureSet);
 	}
-	geometryCubemapShader.unbind();
-
-	//render other models
-	geometryShader.bind();
-	geometryShader.setMat4("projection", getProjectionMatrix());
-	geometryShader.setMat4("view", getViewMatrix());
-	geometryShader.setVec3("viewPos", getCameraPos());
-	for (auto itr = finalModelsToRender.begin(); itr != finalModelsToRender.end(); itr++)
+	for (const drawItem& item : snapshot.items)
 	{
-		if (!(*itr)) { std::cout << "nullptr!" << std::endl; continue; }
-
-		model& model = *(*itr);
-
-		if (model.removeFlag) continue;
-
-		if (model.texture.length() && textureTransparencyMap[model.texture]==true) {
-			finalTransparentModelsToRender.insert(*itr);
-			continue;
+		renderQueue.push(item.isTransparent ? RenderQueue::TRANSPARENT_PASS : RenderQueue::OPAQUE_PASS, item, item.textureSet);
+	}
+	if (cfg.PERF_STATS)
+	{
+		//the state changes the draws would cost in the order of the snapshot, to compare with the binds and toggles below
+		RenderQueue::stateChanges unsorted = renderQueue.countChanges();
+		renderStats.add("texture changes unsorted", unsorted.textures);
+		renderStats.add("cull changes unsorted", unsorted.cullModes);
+	}
+	renderQueue.sort();
+	instanceBuffer.clear();
+	batchItems(RenderQueue::CUBE_PASS, cubeBatches);
+	batchItems(RenderQueue::OPAQUE_PASS, opaqueBatches);
+	batchItems(RenderQueue::TRANSPARENT_PASS, transparentBatches);
+	queriedCubeBatches.clear();
+	if (cfg.OCCLUSION_QUERIES)
+	{
+		for (const drawItem& item : snapshot.cubeItems)
+		{
+			if (isQueried(item.id)) queriedCubeBatches.push_back({ &item, instanceBuffer.push(item.modelMatrix, item.frameIndex), 1 });
 		}
-		model.render(&geometryShader, gVAO, gIBO, textureIdsMap[model.texture], lightmapIdsMap[model.texture], normalmapIdsMap[model.texture], displacementmapIdsMap[model.texture]);
 	}
-
-	for (auto itr = finalTransparentModelsToRender.begin(); itr != finalTransparentModelsToRender.end(); itr++)
+	//the chunks in view, one instance each, whose model matrix is the identity as their vertices are in world space
+	chunkBatches.clear();
+	if (cfg.STATIC_CHUNK_SIZE > 0.0f)
+	{
+		staticChunks.forEachVisible(frustum(snapshot.projectionMatrix * renderViewMatrix), [this](const drawItem& item) {
+			chunkBatches.push_back({ &item, instanceBuffer.push(item.modelMatrix, item.frameIndex, item.layer, item.maps), 1 });
+		});
+		renderStats.add("chunks culled", staticChunks.takeCulledCnt());
+	}
+	instanceBuffer.upload(glState);
+	renderStats.add("instances", instanceBuffer.size());
+	renderStats.add("draws", cubeBatches.size() + queriedCubeBatches.size() + opaqueBatches.size() + chunkBatches.size() + transparentBatches.size());
+	size_t cubeCommands = 0, opaqueCommands = 0, chunkCommands = 0, transparentCommands = 0;
+	if (isIndirectDrawing)
 	{
-		if (!(*itr)) { std::cout << "nullptr!" << std::endl; continue; }
+		indirectBuffer.clear();
+		cubeCommands = pushCommands(cubeBatches);
+		opaqueCommands = pushCommands(opaqueBatches);
+		chunkCommands = pushCommands(chunkBatches);
+		transparentCommands = pushCommands(transparentBatches);
+		indirectBuffer.upload(glState);
+	}
 
-		model& model = *(*itr);
+	submitBatches(cubeBatches, geometryCubemapShader, geometryCubemapShaderUniforms, cubeArena.getVertexArray(), cubeArena.getIndexBuffer(), cubeCommands);
+	//the GPU skips the cubes whose bounding boxes were hidden in the previous frame, drawing those whose queries are not done yet
+	submitBatches(queriedCubeBatches, geometryCubemapShader, geometryCubemapShaderUniforms, cubeArena.getVertexArray(), cubeArena.getIndexBuffer(), 0, true);
 
-		model.render(&geometryShader, gVAO, gIBO, textureIdsMap[model.texture], lightmapIdsMap[model.texture], normalmapIdsMap[model.texture], displacementmapIdsMap[model.texture]);
-	}
-	finalTransparentModelsToRender.clear();
+	//render other models
+	glState.useProgram(gGeometryProgramID);
+	geometryShader.setMat4("projection", snapshot.projectionMatrix);
+	geometryShader.setMat4("view", renderViewMatrix);
+	geometryShader.setVec3("viewPos", renderCameraPos);
+	submitBatches(opaqueBatches, geometryShader, geometryShaderUniforms, modelArena.getVertexArray(), modelArena.getIndexBuffer(), opaqueCommands);
+	submitBatches(chunkBatches, geometryShader, geometryShaderUniforms, staticChunks.getVertexArray(), staticChunks.getIndexBuffer(), chunkCommands);
+
+	//query the bounding boxes of the cubes against the opaque geometry, for the next frame
+	if (cfg.OCCLUSION_QUERIES) issueOcclusionQueries(snapshot);
+
+	//transparent models are drawn back to front
+	glState.useProgram(gGeometryProgramID);
+	submitBatches(transparentBatches, geometryShader, geometryShaderUniforms, modelArena.getVertexArray(), modelArena.getIndexBuffer(), transparentCommands);
 
 	//resolve multisampling
 	if (cfg.MSAA && cfg.MSAA_SAMPLES > 1) {
@@ -697,98 +927,78 @@ void Engine3D::render()
 		glDrawBuffer(GL_COLOR_ATTACHMENT4);
 		glBlitFramebuffer(0, 0, cfg.SCREEN_WIDTH, cfg.SCREEN_HEIGHT, 0, 0, cfg.SCREEN_WIDTH, cfg.SCREEN_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 	}
-	geometryShader.unbind();
 
-	//lighting pass
+	//lighting pass, over the depth of the geometry pass which it keeps
 	glBindFramebuffer(GL_FRAMEBUFFER, lightingBO);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	lightingShader.bind();
-	lightingShader.setVec3("viewPos", getCameraPos());
-	lightingShader.setVec3("light.direction", light.direction);
-	lightingShader.setVec3("light.color", light.color);
-	lightingShader.setFloat("light.ambientIntensity", light.ambientIntensity);
-	lightingShader.setFloat("light.diffuseIntensity", light.diffuseIntensity);
-	lightingShader.setFloat("light.specularIntensity", light.specularIntensity);
-
-	unsigned long pointLightCounter = 0;
-	for (PointLight& pl : pointLights)
+	glClear(GL_COLOR_BUFFER_BIT);
+	glState.setEnabled(GL_DEPTH_TEST, false);
+	glState.setEnabled(GL_BLEND, true);
+	glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glState.useProgram(gLightingProgramID);
+	lightingShader.setVec3("viewPos", renderCameraPos);
+	lightingShader.setVec3("light.direction", lights.light.direction);
+	lightingShader.setVec3("light.color", lights.light.color);
+	lightingShader.setFloat("light.ambientIntensity", lights.light.ambientIntensity);
+	lightingShader.setFloat("light.diffuseIntensity", lights.light.diffuseIntensity);
+	lightingShader.setFloat("light.specularIntensity", lights.light.specularIntensity);
+
+	//the light buffers change only when the editor changed the lights, the shader just gets their counts
+	if (snapshot.lights != uploadedLights)
 	{
-		lightingShader.setVec3("pointLights[" + std::to_string(pointLightCounter) + "].position", pl.position);
-		lightingShader.setVec3("pointLights[" + std::to_string(pointLightCounter) + "].color", pl.color);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter) + "].diffuseIntensity", pl.diffuseIntensity);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter) + "].specularIntensity", pl.specularIntensity);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter) + "].constant", pl.constant);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter) + "].linear", pl.linear);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter) + "].quadratic", pl.quadratic);
-		lightingShader.setFloat("pointLights[" + std::to_string(pointLightCounter++) + "].cutoffDistance", pl.cutoffDistance);
-	}
-
-	unsigned long spotLightCounter = 0;
-	for (SpotLight& sl : spotLights)
+		lightBuffer.upload(glState, lights.pointLights, lights.spotLights);
+		uploadedLights = snapshot.lights;
+		renderStats.add("light uploads");
+	}
+	//with light volumes the full-screen pass is left with the directional light and the flashlight
+	bool isVolumes = cfg.LIGHTING_MODE == LightingMode::VOLUMES;
+	lightingShader.setInt("pointLightsCnt", isVolumes ? 0 : lightBuffer.getPointLightsCnt());
+	lightingShader.setInt("spotLightsCnt", isVolumes ? 0 : lightBuffer.getSpotLightsCnt());
+
+	//the tiles depend on the camera, so the lights are binned again every frame
+	bool isTiled = cfg.LIGHTING_MODE == LightingMode::TILED;
+	lightingShader.setBool("tiledLighting", isTiled);
+	if (isTiled)
 	{
-		lightingShader.setVec3("spotLights[" + std::to_string(spotLightCounter) + "].position", sl.position);
-		lightingShader.setVec3("spotLights[" + std::to_string(spotLightCounter) + "].direction", sl.direction);
-		lightingShader.setVec3("spotLights[" + std::to_string(spotLightCounter) + "].color", sl.color);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].diffuseIntensity", sl.diffuseIntensity);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].specularIntensity", sl.specularIntensity);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].constant", sl.constant);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].linear", sl.linear);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].quadratic", sl.quadratic);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].cutoffDistance", sl.cutoffDistance);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].cutoff", glm::cos(glm::radians(sl.cutoff)));
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter) + "].cutoffAngle", sl.cutoff);
-		lightingShader.setFloat("spotLights[" + std::to_string(spotLightCounter++) + "].outerCutoff", glm::cos(glm::radians(sl.outerCutoff)));
-	}
-
-	lightingShader.setBool("isFlashLightOn", isFlashLightOn);
-	if (assignedFlashLight && isFlashLightOn) {
-		lightingShader.setVec3("flashLight.position", getPersonPos());
-		lightingShader.setVec3("flashLight.direction", getPersonFront());
-		lightingShader.setVec3("flashLight.color", flashLight.color);
-		lightingShader.setFloat("flashLight.diffuseIntensity", flashLight.diffuseIntensity);
-		lightingShader.setFloat("flashLight.specularIntensity", flashLight.specularIntensity);
-		lightingShader.setFloat("flashLight.constant", flashLight.constant);
-		lightingShader.setFloat("flashLight.linear", flashLight.linear);
-		lightingShader.setFloat("flashLight.quadratic", flashLight.quadratic);
-		lightingShader.setFloat("flashLight.cutoffDistance", flashLight.cutoffDistance);
-		lightingShader.setFloat("flashLight.cutoff", glm::cos(glm::radians(flashLight.cutoff)));
-		lightingShader.setFloat("flashLight.cutoffAngle", flashLight.cutoff);
-		lightingShader.setFloat("flashLight.outerCutoff", glm::cos(glm::radians(flashLight.outerCutoff)));
-	}
-
-	lightingShader.setInt("gPosition", 0);
-	lightingShader.setInt("gNormal", 1);
-	lightingShader.setInt("gAlbedo", 2);
-	lightingShader.setInt("gLightmap", 3);
-	lightingShader.setInt("gViewDir", 4);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gAlbedo);
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, gLightmap);
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gViewDir);
+		lightTiles.bin(snapshot.projectionMatrix * renderViewMatrix, lights.pointLights, lights.spotLights);
+		lightTiles.upload(glState);
+		lightingShader.setInt("lightTileSize", lightTiles.getTileSize());
+		lightingShader.setInt("lightTilesX", lightTiles.getTilesX());
+		renderStats.add("tile light refs", lightTiles.getLightRefsCnt());
+	}
+
+	lightingShader.setBool("isFlashLightOn", snapshot.isFlashLightOn);
+	if (lights.assignedFlashLight && snapshot.isFlashLightOn) {
+		const spotLightUniforms& u = flashLightUniforms;
+		lightingShader.setVec3(u.position, snapshot.personPos);
+		lightingShader.setVec3(u.direction, snapshot.personFront);
+		lightingShader.setVec3(u.color, lights.flashLight.color);
+		lightingShader.setFloat(u.diffuseIntensity, lights.flashLight.diffuseIntensity);
+		lightingShader.setFloat(u.specularIntensity, lights.flashLight.specularIntensity);
+		lightingShader.setFloat(u.constant, lights.flashLight.constant);
+		lightingShader.setFloat(u.linear, lights.flashLight.linear);
+		lightingShader.setFloat(u.quadratic, lights.flashLight.quadratic);
+		lightingShader.setFloat(u.cutoffDistance, lights.flashLight.cutoffDistance);
+		lightingShader.setFloat(u.cutoff, glm::cos(glm::radians(lights.flashLight.cutoff)));
+		lightingShader.setFloat(u.cutoffAngle, lights.flashLight.cutoff);
+		lightingShader.setFloat(u.outerCutoff, glm::cos(glm::radians(lights.flashLight.outerCutoff)));
+	}
+
+	bindGBuffer();
+	lightBuffer.bind(glState, 5, 6);
+	if (isTiled) lightTiles.bind(glState, 7, 8);
 
 	renderScreenQuad();
 
+	if (isVolumes && cfg.PHONG_LIGHTING) renderLightVolumes(snapshot);
+
 	//post-processing pass
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glDisable(GL_DEPTH_TEST);
-	lightingShader.unbind();
-	postProcShader.bind();
-	postProcShader.setInt("screenTexture", 0);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, screenTexture);
+	glState.useProgram(gPostProcProgramID);
+	glState.bindTexture(0, GL_TEXTURE_2D, screenTexture);
 
 	renderScreenQuad();
 
-	postProcShader.unbind();
-
 	// glBindFramebuffer(GL_READ_FRAMEBUFFER, gBO);
 	// glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
 	// // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
@@ -799,130 +1009,260 @@ void Engine3D::render()
 
 	//textureShader.unbind();
 
-	mtx.unlock();
-
 	//renderUI();
 
+	renderStats.add("gl calls issued", glState.takeIssuedCnt());
+	renderStats.add("gl calls skipped", glState.takeSkippedCnt());
+
 	//update screen
 	SDL_GL_SwapWindow( gWindow );
 }
 
-void Engine3D::updateVertices()
+void Engine3D::issueOcclusionQueries(const sceneSnapshot& snapshot)
 {
-	std::cout << "Updating vertices" << std::endl;
-	std::vector<GLfloat> vertexData;
-	std::vector<GLuint> indexData;
-	GLuint indexCounter = 0;
-	std::vector<GLfloat> cubeVertexData;
-	std::vector<GLuint> cubeIndexData;
-	GLuint cubeIndexCounter = 0;
-
-	std::vector<GLfloat>* vdp = &vertexData;
-
-	//populate vertex vectors with triangle vertex information for each model
-	for (auto &ptrModel : ptrModelsToRender)
+	glState.useProgram(gOcclusionProgramID);
+	occlusionShader.setMat4("projection", snapshot.projectionMatrix);
+	occlusionShader.setMat4("view", renderViewMatrix);
+	glState.colorMask(false);
+	glState.depthMask(false);
+	//the box of a drawn cube is its own geometry, so it is pulled slightly towards the camera to pass against its own depth
+	glState.depthFunc(GL_LEQUAL);
+	glState.setEnabled(GL_POLYGON_OFFSET_FILL, true);
+	glPolygonOffset(-1.0f, -1.0f);
+	//back faces count too, for the camera may be inside the box
+	setCullFace(false);
+	glState.bindVertexArray(cubeArena.getVertexArray());
+	glState.bindElementBuffer(cubeArena.getIndexBuffer());
+	int modelHandle = occlusionShader.getUniformHandle("model");
+	for (const drawItem& item : snapshot.cubeItems)
 	{
-		if (!ptrModel) continue;
-		model& model = *ptrModel;
+		occlusionQuery& query = occlusionQueries[item.id];
+		if (query.id == 0) glGenQueries(1, &query.id);
+		occlusionShader.setMat4(modelHandle, item.modelMatrix);
+		glBeginQuery(GL_SAMPLES_PASSED, query.id);
+		glDrawElementsBaseVertex(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (void*)(item.firstIndex * sizeof(GLuint)), item.baseVertex);
+		glEndQuery(GL_SAMPLES_PASSED);
+		query.isIssued = true;
+		query.frame = renderFrame;
+	}
+	if (cfg.PERF_STATS) renderStats.add("occlusion queries", snapshot.cubeItems.size());
 
-		if (model.removeFlag) continue;
+	//cubes out of view give their queries back
+	for (auto itr = occlusionQueries.begin(); itr != occlusionQueries.end();)
+	{
+		if (itr->second.frame == renderFrame) { itr++; continue; }
+		glDeleteQueries(1, &itr->second.id);
+		itr = occlusionQueries.erase(itr);
+	}
+
+	setCullFace(true);
+	glState.setEnabled(GL_POLYGON_OFFSET_FILL, false);
+	glState.depthFunc(GL_LESS);
+	glState.depthMask(true);
+	glState.colorMask(true);
+}
 
-		vdp = model.modelMesh.shape == shapetype::CUBE ? &cubeVertexData : &vertexData;
+bool Engine3D::isQueried(unsigned long id) const
+{
+	auto query = occlusionQueries.find(id);
+	return query != occlusionQueries.end() && query->second.isIssued;
+}
 
-		for (auto &tri : model.modelMesh.tris)
+void Engine3D::batchItems(RenderQueue::renderPass pass, std::vector<drawBatch>& batches)
+{
+	batches.clear();
+	const std::vector<RenderQueue::queuedDraw>& draws = renderQueue.getDraws();
+	std::pair<size_t, size_t> range = renderQueue.passRange(pass);
+	GLuint batchTextureId = 0;
+	for (size_t i = range.first; i < range.second; i++)
+	{
+		const drawItem* item = draws[i].item;
+		//the models other than cubes carry the layer of their material, so that the models of the materials in the same arrays batch together
+		size_t instance = instanceBuffer.push(item->modelMatrix, item->frameIndex, item->layer, item->maps);
+		if (!batches.empty() && batchTextureId == draws[i].textureId && batches.back().prototype->isBatchedWith(*item))
 		{
-			glm::vec3 line1 = tri.p[1] - tri.p[0];
-			glm::vec3 line2 = tri.p[2] - tri.p[0];
-			glm::vec3 normal = glm::normalize(glm::cross(line1, line2));
-			//std::cout << "Triangle normal: " << normal.x << ", " << normal.y << ", " << normal.z << std::endl;
-			tri.tang = tri.calcTangent();
+			batches.back().instanceCount++;
+			continue;
+		}
+		batches.push_back({ item, instance, 1 });
+		batchTextureId = draws[i].textureId;
+	}
+}
 
-			for (int i = 0; i < 3; i++)
+size_t Engine3D::pushCommands(const std::vector<drawBatch>& batches)
+{
+	size_t firstCommand = indirectBuffer.size();
+	for (const drawBatch& batch : batches)
+	{
+		const drawItem& item = *batch.prototype;
+		indirectBuffer.push(item.indexCount, batch.instanceCount, item.firstIndex, item.baseVertex, batch.firstInstance);
+	}
+	return firstCommand;
+}
+
+void Engine3D::submitBatches(const std::vector<drawBatch>& batches, ArtificeShaderProgram& shader, const geometryUniforms& u, GLuint vao, GLuint ibo, size_t firstCommand, bool isConditional)
+{
+	const drawItem* texturedItem = nullptr;
+	for (size_t i = 0; i < batches.size();)
+	{
+		const drawBatch& batch = batches[i];
+		const drawItem& item = *batch.prototype;
+		//cubes bind the cubemaps of their set, the other shapes find the maps of their materials in the arrays of a set
+		if (!texturedItem || texturedItem->textureSet != item.textureSet)
+		{
+			if (item.shape == shapetype::CUBE)
 			{
-				vdp->push_back(tri.p[i].x);
-				vdp->push_back(tri.p[i].y);
-				vdp->push_back(tri.p[i].z);
-				vdp->push_back(normal.x);
-				vdp->push_back(normal.y);
-				vdp->push_back(normal.z);
-				vdp->push_back((float)tri.R/255.0f);
-				vdp->push_back((float)tri.G/255.0f);
-				vdp->push_back((float)tri.B/255.0f);
-				vdp->push_back(tri.t[i].x);
-				vdp->push_back(tri.t[i].y);
-				vdp->push_back(tri.tang.x);
-				vdp->push_back(tri.tang.y);
-				vdp->push_back(tri.tang.z);
-				if (model.modelMesh.shape != shapetype::CUBE)
-				{
-					indexData.push_back(indexCounter++);
-				}
-				else
-				{
-					cubeIndexData.push_back(cubeIndexCounter++);
-				}
+				const cubemapSet& c = getCubemapSet(item.textureSet);
+				item.bindTextures(glState, &shader, u, c.texture, c.lightmap, c.normalmap, c.displacementmap);
 			}
+			else textureArrays.bind(glState, item.textureSet);
+			texturedItem = &item;
+			renderStats.add("texture binds");
+		}
+		//rectangles are seen from both sides
+		setCullFace(item.shape != shapetype::RECTANGLE);
+		if (isConditional)
+		{
+			glBeginConditionalRender(occlusionQueries.at(item.id).id, GL_QUERY_NO_WAIT);
+			item.draw(glState, &shader, u, vao, ibo, &instanceBuffer, batch.firstInstance, batch.instanceCount);
+			glEndConditionalRender();
+			renderStats.add("conditional draws");
+			i++;
+			continue;
 		}
+		if (!isIndirectDrawing)
+		{
+			item.draw(glState, &shader, u, vao, ibo, &instanceBuffer, batch.firstInstance, batch.instanceCount);
+			i++;
+			continue;
+		}
+		size_t run = 1;
+		while (i + run < batches.size() && isDrawnWith(item, *batches[i + run].prototype)) run++;
+		item.drawIndirect(glState, &shader, u, vao, ibo, instanceBuffer, indirectBuffer, firstCommand + i, (GLsizei)run);
+		renderStats.add("multi-draws");
+		i += run;
 	}
+}
+
+bool Engine3D::isDrawnWith(const drawItem& a, const drawItem& b) const
+{
+	if (a.textureSet != b.textureSet || (a.shape == shapetype::CUBE) != (b.shape == shapetype::CUBE)) return false;
+	return (a.shape == shapetype::RECTANGLE) == (b.shape == shapetype::RECTANGLE) && a.frameRows == b.frameRows && a.frameCols == b.frameCols;
+}
 
-	// std::cout << "  vertex data size: " << vertexData.size() << std::endl;
-	// std::cout << "  index data size: " << indexData.size() << std::endl;
-	// std::cout << "  cube vertex data size: " << cubeVertexData.size() << std::endl;
-	// std::cout << "  cube index data size: " << cubeIndexData.size() << std::endl;
-
-	//update VBO
-	glBindVertexArray(gVAO);
-	glBindBuffer( GL_ARRAY_BUFFER, gVBO );
-	glBufferData( GL_ARRAY_BUFFER, vertexData.size() * sizeof(GL_FLOAT), vertexData.data(), GL_STATIC_DRAW );
-
-	//position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)0);
-	glEnableVertexAttribArray(0);
-	//normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(3 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(1);
-	//color attribute
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(6 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(2);
-	//texture coord attribute
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(9 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(3);
-	//tangent attribute
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(11 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(4);
-
-	//update IBO
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, gIBO );
-	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GL_UNSIGNED_INT), indexData.data(), GL_STATIC_DRAW );
-
-	//update cubeVBO
-	glBindVertexArray(gCubeVAO);
-	glBindBuffer( GL_ARRAY_BUFFER, gCubeVBO );
-	glBufferData( GL_ARRAY_BUFFER, cubeVertexData.size() * sizeof(GL_FLOAT), cubeVertexData.data(), GL_STATIC_DRAW );
-
-	//position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)0);
-	glEnableVertexAttribArray(0);
-	//normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(3 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(1);
-	//color attribute
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(6 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(2);
-	//texture coord attribute
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(9 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(3);
-	//tangent attribute
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GL_FLOAT), (void*)(11 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(4);
-
-	//update cubeIBO
-	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, gCubeIBO );
-	glBufferData( GL_ELEMENT_ARRAY_BUFFER, cubeIndexData.size() * sizeof(GL_UNSIGNED_INT), cubeIndexData.data(), GL_STATIC_DRAW );
+void Engine3D::setCullFace(bool isEnabled)
+{
+	if (glState.setEnabled(GL_CULL_FACE, isEnabled)) renderStats.add("cull toggles");
+}
 
-	updateVerticesFlag = false;
+void Engine3D::bindGBuffer()
+{
+	glState.bindTexture(0, GL_TEXTURE_2D, gPosition);
+	glState.bindTexture(1, GL_TEXTURE_2D, gNormal);
+	glState.bindTexture(2, GL_TEXTURE_2D, gAlbedo);
+	glState.bindTexture(3, GL_TEXTURE_2D, gLightmap);
+	glState.bindTexture(4, GL_TEXTURE_2D, gViewDir);
+}
+
+void Engine3D::setMaterialSamplers(ArtificeShaderProgram& shader)
+{
+	shader.setInt("material.diffuseTexture", 0);
+	shader.setInt("material.lightmap", 1);
+	shader.setInt("material.normalmap", 2);
+	shader.setInt("material.displacementmap", 3);
+}
+
+void Engine3D::setGBufferSamplers(ArtificeShaderProgram& shader)
+{
+	shader.setInt("gPosition", 0);
+	shader.setInt("gNormal", 1);
+	shader.setInt("gAlbedo", 2);
+	shader.setInt("gLightmap", 3);
+	shader.setInt("gViewDir", 4);
+}
 
-	std::cout << "Updated vertices" << std::endl;
+void Engine3D::renderLightVolumes(const sceneSnapshot& snapshot)
+{
+	glState.useProgram(gLightVolumeProgramID);
+	lightVolumeShader.setMat4("projection", snapshot.projectionMatrix);
+	lightVolumeShader.setMat4("view", renderViewMatrix);
+	lightVolumeShader.setVec2("screenSize", (float)cfg.SCREEN_WIDTH, (float)cfg.SCREEN_HEIGHT);
+	bindGBuffer();
+
+	//the lights add up, each over the pixels whose geometry lies in front of the back faces of its volume:
+	//back faces still cover the screen when the camera is inside the volume, and the fragment shader rejects the pixels in front of it
+	glState.blendFunc(GL_ONE, GL_ONE);
+	glState.setEnabled(GL_DEPTH_TEST, true);
+	glState.depthMask(false);
+	glState.depthFunc(GL_GEQUAL);
+	glState.cullFace(GL_FRONT);
+	//volumes reaching beyond the far plane keep their back faces, at the far plane
+	glState.setEnabled(GL_DEPTH_CLAMP, true);
+
+	lightBuffer.bindPointLights(glState, 5);
+	lightVolumeShader.setInt("lightTexels", LightBuffer::POINT_LIGHT_TEXELS);
+	lightVolumeShader.setInt("volumeShape", 0);
+	lightVolumes.drawSpheres(glState, lightBuffer.getPointLightsCnt());
+
+	lightBuffer.bindSpotLights(glState, 5);
+	lightVolumeShader.setInt("lightTexels", LightBuffer::SPOT_LIGHT_TEXELS);
+	lightVolumeShader.setInt("volumeShape", 1);
+	lightVolumes.drawCones(glState, lightBuffer.getSpotLightsCnt());
+	lightVolumeShader.setInt("volumeShape", 2);
+	lightVolumes.drawSpheres(glState, lightBuffer.getSpotLightsCnt());
+	renderStats.add("light volumes", lightBuffer.getPointLightsCnt() + lightBuffer.getSpotLightsCnt());
+
+	glState.setEnabled(GL_DEPTH_CLAMP, false);
+	glState.cullFace(GL_BACK);
+	glState.depthFunc(GL_LESS);
+	glState.depthMask(true);
+	glState.setEnabled(GL_DEPTH_TEST, false);
+	glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+Engine3D::spotLightUniforms Engine3D::resolveSpotLightUniforms(const std::string& name) const
+{
+	spotLightUniforms u;
+	u.position = lightingShader.getUniformHandle(name + ".position");
+	u.direction = lightingShader.getUniformHandle(name + ".direction");
+	u.color = lightingShader.getUniformHandle(name + ".color");
+	u.diffuseIntensity = lightingShader.getUniformHandle(name + ".diffuseIntensity");
+	u.specularIntensity = lightingShader.getUniformHandle(name + ".specularIntensity");
+	u.constant = lightingShader.getUniformHandle(name + ".constant");
+	u.linear = lightingShader.getUniformHandle(name + ".linear");
+	u.quadratic = lightingShader.getUniformHandle(name + ".quadratic");
+	u.cutoffDistance = lightingShader.getUniformHandle(name + ".cutoffDistance");
+	u.cutoff = lightingShader.getUniformHandle(name + ".cutoff");
+	u.cutoffAngle = lightingShader.getUniformHandle(name + ".cutoffAngle");
+	u.outerCutoff = lightingShader.getUniformHandle(name + ".outerCutoff");
+	return u;
+}
+
+void Engine3D::updateVertices()
+{
+	//the models that never move are merged into chunks first, the model being edited follows the person until placed so it is left out:
+	//edit() does not run while the flag is up, so the editing model is not replaced while it is read here
+	if (cfg.STATIC_CHUNK_SIZE > 0.0f)
+	{
+		const model* editing = editingModel.get();
+		staticChunks.update(ptrModelsToRender, [this, editing](const model& m) {
+			bool isTransparent = m.texture.length() && textureTransparencyMap[m.texture]==true;
+			return &m != editing && m.speed <= 0.0f && m.modelMesh.shape != shapetype::CUBE && m.frameRows * m.frameCols == 1 && !isTransparent;
+		}, [this](drawItem& item, const model& mesh) { resolveMaterial(item, mesh); });
+		renderStats.add("chunk rebuilds", staticChunks.takeRebuiltCnt());
+		renderStats.add("merged models", staticChunks.getMergedCnt());
+	}
+
+	//only the meshes added or changed since the last update are uploaded, the merged models are in their chunks
+	modelArena.update(ptrModelsToRender, [this](const model& m) { return m.modelMesh.shape != shapetype::CUBE && !staticChunks.isMerged(&m); });
+	cubeArena.update(ptrModelsToRender, [](const model& m) { return m.modelMesh.shape == shapetype::CUBE; });
+	renderStats.add("uploaded vertices", modelArena.takeUploadedCnt() + cubeArena.takeUploadedCnt() + staticChunks.takeUploadedCnt());
+	renderStats.add("shared vertices", modelArena.takeSharedCnt() + cubeArena.takeSharedCnt());
+	renderStats.add("arena compactions", modelArena.takeCompactionsCnt() + cubeArena.takeCompactionsCnt());
+
+	updateVerticesFlag = false;
+	//the vertex arrays and buffers were bound behind the state cache
+	glState.invalidate();
 }
 
 /*
@@ -947,16 +1287,10 @@ void Engine3D::renderUI()
 
 bool Engine3D::update(float elapsedTime)
 {
-	mtx.lock();
+	lockCounted(updateStats);
 
 	captureInput();
 
-	glm::vec3 prevPersonPos = personPos;
-	glm::vec2 center{ 0.5f, 0.5f };
-	float modelDistance = dof;
-	float minModelDist = dof;
-	glm::vec4 collidingTriPts[3];
-
 	move(elapsedTime);
 
 	collides = false;
@@ -972,184 +1306,133 @@ bool Engine3D::update(float elapsedTime)
 	projectionMatrix = glm::perspective(glm::radians((float)fov), (float)width / (float)height, near, far);
 	viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
-	mtx.unlock();
-
-	int cnt = 0;
-
-	//for each model to render
-	for (auto &ptrModel : ptrModelsToRender)
-	{
-		if (!ptrModel) continue;
-		model& mdl = *ptrModel;
-
-		//ignore for some loops
-		if (mdl.ignoreForCycles > 0) {
-			mdl.ignoreForCycles--;
-			continue;
-		}
-
-		float camDist = glm::distance(getCameraPos(), mdl.position);
-
-		//mark out-of-DOF models to avoid needless rendering
-		mdl.isInDOF = camDist < dof;
-		if (!mdl.isInDOF) {
-			mdl.inFocus = false;
-			mtx.lock();
-			modelsInFocus.erase(ptrModel);
-			mtx.unlock();
-			continue;
-		}
-
-		//mark far and out-of-FOV models to avoid needless rendering
-		mdl.isInFOV = isInFOV(mdl) || (userMode == UserMode::PLAYER && (camDist < 2.0f * collidingDistanceH || camDist < 2.0f * collidingDistanceV));
-		if (!mdl.isInFOV) {
-			mdl.inFocus = false;
-			mtx.lock();
-			modelsInFocus.erase(ptrModel);
-			mtx.unlock();
-			continue;
-		}
-
-		//models that are far away will be ignored for next two loops
-		if (mdl.ignoreForCycles == 0 && camDist > 5.0f * collidingDistanceH && camDist > 5.0f * collidingDistanceV) {
-			mdl.ignoreForCycles = 2;
-		}
+	updateTick++;
+	updateScheduler.beginTick(updateTick, getCameraPos());
 
-		mtx.lock();
-		glm::mat4 modelMatrix = glm::mat4(1.0f); //make sure to initialize matrix to identity matrix first
-		modelMatrix = glm::translate(modelMatrix, mdl.position);
-		modelMatrix = modelMatrix * mdl.rotationMatrix;
-		mdl.modelMatrix = modelMatrix;
+	//refit the models that may have moved since the last tick
+	for (auto &ptrModel : ptrMovingModels) refitModel(ptrModel);
+	if (editingModel != nullptr) refitModel(editingModel);
 
-		mdl.inFocus = false;
-		float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f, minZ = 100000.0f, maxZ = -100000.0f;
+	mtx.unlock();
 
-		//if cube is skybox, then do not process further
-		if (mdl.modelMesh.shape == shapetype::CUBE)
-		{
-			cubeModel& cube = dynamic_cast<cubeModel &>(mdl);
-			if (cube.isSkyBox)
-			{
-				mdl.isInDOF = true;
-				mdl.isInFOV = true;
-				mdl.isCovered = false;
-				mtx.unlock();
-				continue;
-			}
+	//query the BVH for the models within DOF and for those near the person, instead of iterating all models
+	prevModelsInRange.swap(modelsInRange);
+	prevHandlesInRange.swap(handlesInRange);
+	modelsInRange.clear();
+	handlesInRange.clear();
+	modelsBVH.querySphere(getCameraPos(), dof, [&](const std::shared_ptr<model>& m) {
+		modelStore.lastInRangeTick[m->handle] = updateTick;
+		modelsInRange.push_back(m);
+		handlesInRange.push_back(m->handle);
+	});
+	modelsBVH.querySphere(personPos, 2.0f * std::max(collidingDistanceH, collidingDistanceV), [&](const std::shared_ptr<model>& m) {
+		int h = m->handle;
+		modelStore.lastNearPersonTick[h] = updateTick;
+		if (modelStore.lastInRangeTick[h] != updateTick) {
+			modelStore.lastInRangeTick[h] = updateTick;
+			modelsInRange.push_back(m);
+			handlesInRange.push_back(h);
 		}
-		mtx.unlock();
+	});
+	for (auto &ptrModel : ptrSkyBoxes)
+	{
+		modelsInRange.push_back(ptrModel);
+		handlesInRange.push_back(ptrModel->handle);
+	}
 
-		modelDistance = dof;
-		minModelDist = dof;
-		
-		//initialize highest and lowest Y positions of model
-		float highestYOfModel = (modelMatrix * mdl.modelMesh.tris[0].p[0]).y;
-		float lowestYOfModel  = (modelMatrix * mdl.modelMesh.tris[0].p[0]).y;
+	//models that left the DOF since the last tick are neither in focus nor rendered anymore
+	lockCounted(updateStats);
+	for (size_t i = 0; i < prevModelsInRange.size(); i++)
+	{
+		std::shared_ptr<model>& ptrModel = prevModelsInRange[i];
+		int h = prevHandlesInRange[i];
+		//skip models removed since, their handle may already belong to another model
+		if (modelStore.models[h] != ptrModel.get() || modelStore.lastInRangeTick[h] == updateTick) continue;
+		modelStore.isInDOF[h] = 0;
+		modelStore.inFocus[h] = 0;
+		modelsInFocus.erase(ptrModel);
+		if (ptrModel->modelMesh.shape == shapetype::CUBE) finalCubeModelsToRender.erase(ptrModel);
+		else finalModelsToRender.erase(ptrModel);
+	}
+	mtx.unlock();
 
-		for (auto tri : mdl.modelMesh.tris)
+	glm::mat4 viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+	//frustum cull the models in range as a batch, against their world-space bounding boxes in the model store
+	viewFrustum.extract(viewProjectionMatrix);
+	visibilityInRange.resize(handlesInRange.size());
+	viewFrustum.intersects(modelStore.worldBoxes, handlesInRange.data(), handlesInRange.size(), visibilityInRange.data());
+
+	//the person as an upright capsule from the feet to the eyes, as wide as the horizontal colliding distance
+	float feetY = personPos.y - collidingDistanceV;
+	personCapsule.radius = collidingDistanceH;
+	personCapsule.b = personPos;
+	personCapsule.a = glm::vec3(personPos.x, std::min(feetY + collidingDistanceH, personPos.y), personPos.z);
+
+	//map phase: process the models in range in parallel, each task writing only to its own model and result
+	std::shared_ptr<model> editing = editingModel;
+	updateResults.resize(modelsInRange.size());
+	size_t grain = std::max((size_t)1, modelsInRange.size() / (threadPool->size() * 4));
+	threadPool->parallelFor(modelsInRange.size(), grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) updateModelInRange(i, viewProjectionMatrix, editing);
+	});
+
+	//reduction phase: resolve focus and collision in candidate order, so that the outcome is deterministic
+	lockCounted(updateStats);
+	for (size_t i = 0; i < modelsInRange.size(); i++)
+	{
+		std::shared_ptr<model>& ptrModel = modelsInRange[i];
+		modelUpdateResult& result = updateResults[i];
+		if (result.isScheduled)
 		{
-			glm::vec4 pt[3];
-			pt[0] = tri.p[0];
-			pt[1] = tri.p[1];
-			pt[2] = tri.p[2];
-
-			//model transformation
-			pt[0] = modelMatrix * pt[0];
-			pt[1] = modelMatrix * pt[1];
-			pt[2] = modelMatrix * pt[2];
-
-			//finds distance from model
-			glm::vec4 avgP = ( (pt[0]) + (pt[1]) + (pt[2]) ) / 3.0f;
-			float avgDist = glm::distance(personPos, glm::vec3(avgP));
-			float dist1 = glm::distance(personPos, glm::vec3(pt[0]));
-			float dist2 = glm::distance(personPos, glm::vec3(pt[1]));
-			float dist3 = glm::distance(personPos, glm::vec3(pt[2]));
-			float maxDist = std::max(dist1, std::max(dist2, dist3));
-			float minDist = std::min(dist1, std::min(dist2, dist3));
-			float highestYInTri = std::max(pt[0].y, std::max(pt[1].y, pt[2].y));
-			float lowestYInTri = std::min(pt[0].y, std::min(pt[1].y, pt[2].y));
-			if (highestYOfModel < highestYInTri) { highestYOfModel = highestYInTri; mdl.highestY = highestYInTri; }
-			if (lowestYOfModel > lowestYInTri) { lowestYOfModel = lowestYInTri; mdl.lowestY = lowestYInTri; }
-			if (avgDist < modelDistance) {
-				modelDistance = avgDist;
-				minModelDist = minDist;
-				mdl.distance = minDist;
-				collidingTriPts[0] = pt[0];
-				collidingTriPts[1] = pt[1];
-				collidingTriPts[2] = pt[2];
-			}
-			if (minDist < minModelDist) {
-				minModelDist = minDist;
-				mdl.distance = minDist;
-			}
-			//std::cout << "modelDistance: " << modelDistance << std::endl;
-
-			//camera/view transformation
-			pt[0] = projectionMatrix * viewMatrix * pt[0];
-			pt[1] = projectionMatrix * viewMatrix * pt[1];
-			pt[2] = projectionMatrix * viewMatrix * pt[2];
-
-			mtx.lock();
-			tri.p[0] = pt[0];
-			tri.p[1] = pt[1];
-			tri.p[2] = pt[2];
-			mtx.unlock();
-
-			//calculate bounding box
-			minX = std::min(minX, std::min(std::min(pt[0].x/pt[0].w, pt[1].x/pt[1].w), pt[2].x/pt[2].w));
-			minY = std::min(minY, std::min(std::min(pt[0].y/pt[0].w, pt[1].y/pt[1].w), pt[2].y/pt[2].w));
-			minZ = std::min(minZ, std::min(std::min(pt[0].z, pt[1].z), pt[2].z));
-			maxX = std::max(maxX, std::max(std::max(pt[0].x/pt[0].w, pt[1].x/pt[1].w), pt[2].x/pt[2].w));
-			maxY = std::max(maxY, std::max(std::max(pt[0].y/pt[0].w, pt[1].y/pt[1].w), pt[2].y/pt[2].w));
-			maxZ = std::max(maxZ, std::max(std::max(pt[0].z, pt[1].z), pt[2].z));
-		}
-
-		//assign bounding box, to check for coverage later
-		minX = (std::max(-1.0f, minX) + 1) / 2.0f;
-		minY = (std::max(-1.0f, minY) + 1) / 2.0f;
-		maxX = (std::min(1.0f, maxX) + 1) / 2.0f;
-		maxY = (std::min(1.0f, maxY) + 1) / 2.0f;
-		boundingbox bbox = { minX, maxX, minY, maxY, minZ, maxZ };
-		mdl.bbox = bbox;
-
-		//determine if in focus
-		if (mdl.bbox.minX < center.x && mdl.bbox.maxX > center.x && mdl.bbox.minY < center.y && mdl.bbox.maxY > center.y) {
-			mtx.lock();
-			//don't focus on editing models about to be placed
-			if (editingModel == nullptr || mdl.id != (*editingModel).id ) {
-				mdl.inFocus = true;
-				modelsInFocus.insert(ptrModel);
-			}
-			mtx.unlock();
-		} else {
-			mtx.lock();
-			modelsInFocus.erase(ptrModel);
-			mtx.unlock();
+			updateStats.add(tierModelsCounters[result.tier]);
+			if (result.isUpdated) updateStats.add(tierUpdatesCounters[result.tier]);
 		}
+		if (!result.isProcessed) continue;
+		if (result.isFocused) modelsInFocus.insert(ptrModel);
+		else modelsInFocus.erase(ptrModel);
+	}
+	mtx.unlock();
 
-		//get the triangle normal
-		glm::vec3 line1 = collidingTriPts[1] - collidingTriPts[0];
-		glm::vec3 line2 = collidingTriPts[2] - collidingTriPts[0];
-		glm::vec3 normal = glm::normalize(glm::cross(line1, line2));
+	//respond to the contacts of the person's capsule with the boxes of the models near it
+	for (size_t i = 0; i < modelsInRange.size(); i++)
+	{
+		modelUpdateResult& result = updateResults[i];
+		if (!result.canCollide) continue;
+		model& mdl = *modelsInRange[i];
+		if (!mdl.isSolid) continue;
+		int h = handlesInRange[i];
+
+		const contact& c = result.personContact;
+		float highestYOfModel = modelStore.worldBoxes.maxY[h];
+		glm::vec3 normal = c.normal;
 		float dpBottom = glm::dot(personUp, normal); //dot product is near to 1 means collision with floor
+		float personFeetY = personPos.y - collidingDistanceV;
 
-		//detect vertical collision (floor)
-		if (mdl.isSolid && minModelDist < collidingDistanceV * 1.5f && std::abs(dpBottom) > 0.5f && highestYOfModel < personPos.y/2.0f && lowestYOfModel < personPos.y) {
+		//detect vertical collision (floor below, ceiling above)
+		if (dpBottom > 0.5f) {
 			hasLanded = true;
-			//determine whether to climb (stairs, ramps, etc.): if the highest Y is above ground and lower than half the person height
-			if (personPos.y - collidingDistanceV < highestYOfModel) {
-				shouldClimb = true;
-				//std::cout << "SHOULD CLIMB" << std::endl;
-			}
-			//std::cout << "personPos.y = " << personPos.y << ", minModelDist = " << minModelDist << ", highestYOfModel = " << highestYOfModel << std::endl;
-			//std::cout << normal.x << ", " << normal.y << ", " << normal.z << std::endl;
-		} else if (mdl.isSolid && minModelDist < collidingDistanceV * 2.0f && std::abs(dpBottom) < 0.5f && lowestYOfModel >= personPos.y && highestYOfModel > personPos.y) {
+			//sunk into the floor, climb out of it
+			if (personFeetY < highestYOfModel) shouldClimb = true;
+			//std::cout << "personPos.y = " << personPos.y << ", penetration = " << c.penetration << ", highestYOfModel = " << highestYOfModel << std::endl;
+			continue;
+		} else if (dpBottom < -0.5f) {
 			jumpSpeed = 0.0f;
+			continue;
+		}
+
+		//determine whether to climb (stairs, ramps, etc.): if the highest Y is above ground and lower than half the person height
+		if (highestYOfModel > personFeetY && highestYOfModel < personFeetY + collidingDistanceV / 2.0f) {
+			hasLanded = true;
+			shouldClimb = true;
+			//std::cout << "SHOULD CLIMB" << std::endl;
+			continue;
 		}
+
 		//detect horizontal collision (wall)
-		if (!collides && mdl.isSolid && modelDistance <= collidingDistanceH * 1.5f && std::abs(dpBottom) <= 0.5f)
+		if (!collides)
 		{
-			//std::cout << "modelDistance: " << modelDistance << std::endl;
+			//std::cout << "penetration: " << c.penetration << std::endl;
 			//std::cout << "dpBottom: " << dpBottom << std::endl;
 
 			//based on dp and normal, determine if able to slide and the desired motion
@@ -1162,7 +1445,6 @@ bool Engine3D::update(float elapsedTime)
 			canSlide = absDP < 0.8f && absDP > 0.0f;
 			//std::cout << "absDP: " << absDP << std::endl;
 			//std::cout << "dpFront: " << dpFront << std::endl;
-			//std::cout << "modelDistance: " << modelDistance << std::endl;
 			collides = true;
 			if (!collidesFront) collidesFront = dpFront < dpRight && dpFront < dpLeft && dpFront < dpBack;
 			if (!collidesBack)  collidesBack  = dpBack < dpRight && dpBack < dpLeft && dpBack < dpFront;
@@ -1175,33 +1457,35 @@ bool Engine3D::update(float elapsedTime)
 			//std::cout << desiredMotion.x << ", " << desiredMotion.z << std::endl;
 		}
 
-		if (mdl.isSolid && modelDistance < collidingDistanceH * 0.5f)
+		//push the person out of the wall along its normal, horizontally only to be able to fall if collided in the air
+		if (c.penetration > 0.0f)
 		{
-			float personPosY = personPos.y; // to be able to fall if collided in the air
-			setPersonPos(glm::vec3(prevPersonPos.x, personPosY, prevPersonPos.z));
+			glm::vec3 pushOut = normal * c.penetration;
+			pushOut.y = 0.0f;
+			setPersonPos(personPos + pushOut);
 		}
 
 	}
 
-	//mark covered models to avoid needless rendering
-	//disabled to achieve transparency
-	//mtx.lock();
-	//markCoveredModels();
-	//mtx.unlock();
+	//mark models hidden behind the largest opaque models to avoid needless rendering
+	if (cfg.OCCLUSION_CULLING) cullOccludedModels(viewProjectionMatrix);
 
-	mtx.lock();
-	for (auto &ptrModel : ptrModelsToRender)
+	lockCounted(updateStats);
+	//move models
+	for (auto &ptrModel : ptrMovingModels)
 	{
-		if (!ptrModel) continue;
+		//ptrModel->position += ptrModel->speed * ptrModel->front * elapsedTime;
+		ptrModel->setPosition(ptrModel->position + ptrModel->speed * glm::normalize(personPos - ptrModel->position) * elapsedTime);
+	}
 
-		//move model
-		if (ptrModel->speed > 0) {
-			//ptrModel->position += ptrModel->speed * ptrModel->front * elapsedTime;
-			ptrModel->position += ptrModel->speed * glm::normalize(personPos - ptrModel->position) * elapsedTime;
-		}
+	for (size_t i = 0; i < modelsInRange.size(); i++)
+	{
+		std::shared_ptr<model>& ptrModel = modelsInRange[i];
+		if (!ptrModel) continue;
+		int h = handlesInRange[i];
 
-		//render if model is near, or not covered, in DOF and in FOV
-		if (ptrModel->distance <= 2.0f || (!ptrModel->isCovered && ptrModel->isInDOF && ptrModel->isInFOV))
+		//render if model is not covered, in DOF and in FOV
+		if (!modelStore.isCovered[h] && modelStore.isInDOF[h] && modelStore.isInFOV[h])
 		{
 			if (ptrModel->modelMesh.shape == shapetype::CUBE) finalCubeModelsToRender.insert(ptrModel);
 			else finalModelsToRender.insert(ptrModel);
@@ -1217,20 +1501,88 @@ bool Engine3D::update(float elapsedTime)
 
 	edit(elapsedTime);
 
+	//under the lock, as the rendering thread writes where the meshes are and which models are merged into chunks while it holds it
+	lockCounted(updateStats);
+	publishSnapshot();
+	mtx.unlock();
+
+	if (cfg.PERF_STATS) updateStats.tick();
+
 	//std::cout <<"collides? " << collides << ", canSlide? " << canSlide << ", hasLanded? " << hasLanded << std::endl;
 	return true;
 }
 
-bool Engine3D::isInFOV(model& m)
+void Engine3D::updateModelInRange(size_t i, const glm::mat4& viewProjectionMatrix, const std::shared_ptr<model>& editing)
 {
-	glm::vec3 directionToModel = glm::normalize(m.position - cameraPos);
-	glm::vec3 camUp = glm::normalize(glm::cross(cameraRight, cameraFront));
-	//horizontal and vertical model to camera angle to determine whether in FOV
-	float angle  = glm::degrees(glm::angle(cameraFront, directionToModel));
-	float angleH = glm::degrees(glm::angle(cameraRight, directionToModel));
-	float angleV = glm::degrees(glm::angle(camUp, glm::normalize(directionToModel - glm::dot(directionToModel, cameraRight) * cameraRight)));
-
-	return !(angle > fov || angleH > 90 + fovHHalf + 5 || angleH < 90 - fovHHalf - 5 || angleV > 90 + fovHalf + 5 || angleV < 90 - fovHalf - 5);
+	modelUpdateResult& result = updateResults[i];
+	result = modelUpdateResult();
+	std::shared_ptr<model>& ptrModel = modelsInRange[i];
+	if (!ptrModel) return;
+	int h = handlesInRange[i];
+	bool isNearPerson = modelStore.lastNearPersonTick[h] == updateTick;
+	glm::vec2 center{ 0.5f, 0.5f };
+
+	//if cube is skybox, then do not process further
+	if (modelStore.isSkyBox[h])
+	{
+		modelStore.isInDOF[h] = 1;
+		modelStore.isInFOV[h] = 1;
+		modelStore.isCovered[h] = 0;
+		return;
+	}
+
+	//mark out-of-DOF models to avoid needless rendering
+	float camDistSq = BVH::distanceSquared(modelStore.worldBoxes.get(h), getCameraPos());
+	modelStore.isInDOF[h] = camDistSq < dof * dof;
+	modelStore.isInFOV[h] = visibilityInRange[i];
+
+	//out-of-DOF and out-of-FOV models are not rendered nor focused, but those near the person are still checked for collision
+	if ((!modelStore.isInDOF[h] || !modelStore.isInFOV[h]) && !isNearPerson) {
+		modelStore.inFocus[h] = 0;
+		result.isProcessed = true;
+		return;
+	}
+
+	//models near the person and the one being edited are updated every tick, the others by their distance from the camera
+	result.isScheduled = true;
+	result.tier = isNearPerson || modelStore.models[h] == editing.get() ? updatetier::EVERY_TICK : updateScheduler.classify(camDistSq);
+	if (!updateScheduler.isDue(h, result.tier, modelStore.updatedCellEpoch[h])) return;
+	modelStore.updatedCellEpoch[h] = updateScheduler.getCellEpoch();
+	modelStore.inFocus[h] = 0;
+	result.isUpdated = true;
+	result.isProcessed = true;
+
+	//from here on the model itself is needed, for its cached world-space geometry
+	model& mdl = *ptrModel;
+
+	//the cached world-space geometry is read only: every model that changed was refitted under the lock before the map phase
+
+	//transform the cached triangles to clip space, reduce the NDC bounding box and find the nearest vertex in one vectorized pass
+	clipResult clip;
+	clip.minVertexDistSq = dof * dof;
+	clipKernel::clipTriangles(mdl.worldTris, viewProjectionMatrix, personPos, clip);
+
+	float minModelDist = std::sqrt(clip.minVertexDistSq);
+	modelStore.distance[h] = minModelDist;
+
+	//assign bounding box, to check for coverage later
+	float minX = (std::max(-1.0f, clip.minX) + 1) / 2.0f;
+	float minY = (std::max(-1.0f, clip.minY) + 1) / 2.0f;
+	float maxX = (std::min(1.0f, clip.maxX) + 1) / 2.0f;
+	float maxY = (std::min(1.0f, clip.maxY) + 1) / 2.0f;
+	boundingbox bbox = { minX, maxX, minY, maxY, clip.minZ, clip.maxZ };
+	modelStore.screenBoxes[h] = bbox;
+
+	//determine if in focus, don't focus on editing models about to be placed
+	if (modelStore.isInDOF[h] && modelStore.isInFOV[h] && bbox.minX < center.x && bbox.maxX > center.x && bbox.minY < center.y && bbox.maxY > center.y) {
+		result.isFocused = editing == nullptr || mdl.id != editing->id;
+		modelStore.inFocus[h] = result.isFocused;
+	}
+
+	//only models returned by the BVH query around the person can collide, tested analytically as oriented boxes (quads for rectangles)
+	if (!isNearPerson || collidingDistanceH <= 0.0f || collidingDistanceV <= 0.0f) return;
+	result.personContact = collision::capsuleVsBox(personCapsule, orientedbox::fromModel(mdl), collidingDistanceV / 2.0f);
+	result.canCollide = result.personContact.isTouching;
 }
 
 void Engine3D::captureInput()
@@ -1239,31 +1591,89 @@ void Engine3D::captureInput()
 	std::memcpy(keysPressed, eventController->getKeysPressed(), SupportedKeys::ALL_KEYS * sizeof(bool));
 }
 
-void Engine3D::markCoveredModels()
+void Engine3D::cullOccludedModels(const glm::mat4& viewProjectionMatrix)
 {
-	for (auto &ptrCube1 : ptrModelsToRender)
+	//every model in view is a candidate, the opaque ones with an up-to-date world-space cache can also be occluders
+	occlusionCandidates.clear();
+	occluders.clear();
+	bool isTransparencyKnown = areTexturesLoaded;
+	for (size_t i = 0; i < modelsInRange.size(); i++)
 	{
-		if (!ptrCube1) continue;
-		//if (!ptrCube1->isInDOF || !ptrCube1->isInFOV) continue;
-		model& model1 = *ptrCube1;
-		for (auto &ptrCube2 : ptrModelsToRender)
-		{
-			if (!ptrCube2) continue;
-			//if (!ptrCube2->isInDOF || !ptrCube2->isInFOV) continue;
-			model& model2 = *ptrCube2;
-			model1.isCovered = model2.bbox.minX > 0 && model2.bbox.maxX < 1 &&
-							   model2.bbox.minY > 0 && model2.bbox.maxY < 1 &&
-							   model1.bbox.minX > model2.bbox.minX &&
-							   model1.bbox.maxX < model2.bbox.maxX &&
-							   model1.bbox.minY > model2.bbox.minY &&
-							   model1.bbox.maxY < model2.bbox.maxY &&
-							   model1.bbox.maxZ > model2.bbox.minZ;
-
-			if (model1.isCovered) break;
+		if (!modelsInRange[i]) continue;
+		int h = handlesInRange[i];
+		modelStore.isCovered[h] = 0;
+		if (modelStore.isSkyBox[h] || !modelStore.isInDOF[h] || !modelStore.isInFOV[h]) continue;
+		occlusionCandidates.push_back(i);
+		const model& m = *modelsInRange[i];
+		if (!isTransparencyKnown || m.isDirty || m.removeFlag) continue;
+		if (m.modelMesh.shape != shapetype::CUBE && transparentTextures.count(m.texture)) continue;
+		occluders.push_back(i);
+	}
 
+	//the models covering most of the screen hide the most, so only the largest ones are rasterized
+	size_t occludersCnt = std::min((size_t)cfg.OCCLUSION_OCCLUDERS, occluders.size());
+	auto screenArea = [&](size_t i) {
+		const boundingbox& b = modelStore.screenBoxes[handlesInRange[i]];
+		return (b.maxX - b.minX) * (b.maxY - b.minY);
+	};
+	std::partial_sort(occluders.begin(), occluders.begin() + occludersCnt, occluders.end(), [&](size_t a, size_t b) { return screenArea(a) > screenArea(b); });
+
+	occlusionBuffer->clear(viewProjectionMatrix);
+	for (size_t k = 0; k < occludersCnt; k++) occlusionBuffer->addOccluder(modelsInRange[occluders[k]]->worldTris);
+	threadPool->parallelFor(occlusionBuffer->getBandsCnt(), 1, [&](size_t begin, size_t end) {
+		for (size_t band = begin; band < end; band++) occlusionBuffer->rasterizeBand(band);
+	});
+
+	size_t grain = std::max((size_t)1, occlusionCandidates.size() / (threadPool->size() * 4));
+	threadPool->parallelFor(occlusionCandidates.size(), grain, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; j++)
+		{
+			int h = handlesInRange[occlusionCandidates[j]];
+			modelStore.isCovered[h] = !occlusionBuffer->isVisible(modelStore.worldBoxes.get(h));
 		}
-		//std::cout << "model " << model1.id << " is covered? " << model1.isCovered << std::endl;
+	});
+
+	if (!cfg.PERF_STATS) return;
+	size_t culledCnt = 0;
+	for (size_t i : occlusionCandidates) culledCnt += modelStore.isCovered[handlesInRange[i]];
+	updateStats.add("occluders", occludersCnt);
+	updateStats.add("occluder triangles", occlusionBuffer->getTrianglesCnt());
+	updateStats.add("occlusion candidates", occlusionCandidates.size());
+	updateStats.add("occlusion culled", culledCnt);
+}
+
+void Engine3D::registerModel(std::shared_ptr<model> m)
+{
+	m->markDirty();
+	m->refresh();
+	m->handle = modelStore.add(m.get());
+	if (m->modelMesh.shape == shapetype::CUBE && std::dynamic_pointer_cast<cubeModel>(m)->isSkyBox)
+	{
+		modelStore.isSkyBox[m->handle] = 1;
+		ptrSkyBoxes.push_back(m);
+		return;
 	}
+	modelStore.proxy[m->handle] = modelsBVH.insert(m, m->worldBBox);
+	if (m->speed > 0) ptrMovingModels.push_back(m);
+}
+
+void Engine3D::unregisterModel(std::shared_ptr<model> m)
+{
+	if (modelStore.isValid(m->handle))
+	{
+		if (modelStore.proxy[m->handle] >= 0) modelsBVH.remove(modelStore.proxy[m->handle]);
+		modelStore.remove(m->handle);
+	}
+	m->handle = -1;
+	ptrSkyBoxes.erase(std::remove(ptrSkyBoxes.begin(), ptrSkyBoxes.end(), m), ptrSkyBoxes.end());
+	ptrMovingModels.erase(std::remove(ptrMovingModels.begin(), ptrMovingModels.end(), m), ptrMovingModels.end());
+}
+
+void Engine3D::refitModel(std::shared_ptr<model> m)
+{
+	if (!m->refresh() || !modelStore.isValid(m->handle)) return;
+	modelStore.refit(m->handle);
+	if (modelStore.proxy[m->handle] >= 0) modelsBVH.update(modelStore.proxy[m->handle], m->worldBBox);
 }
 
 void Engine3D::move(float elapsedTime)
@@ -1427,8 +1837,12 @@ bool Engine3D::stopEngine(std::thread& engineThreadToJoin)
 	geometryCubemapShader.freeProgram();
 	geometrySkyboxShader.unbind();
 	geometrySkyboxShader.freeProgram();
+	occlusionShader.unbind();
+	occlusionShader.freeProgram();
 	lightingShader.unbind();
 	lightingShader.freeProgram();
+	lightVolumeShader.unbind();
+	lightVolumeShader.freeProgram();
 	postProcShader.unbind();
 	postProcShader.freeProgram();
 
@@ -1588,6 +2002,7 @@ void Engine3D::setLevel(Level* level)
 		{
 			ptrModelsToRender.push_back(std::make_shared<model>(m));
 		}
+		registerModel(ptrModelsToRender.back());
 	}
 	modelPointsCnt = level->modelPointsCnt;
 	cubePointsCnt = level->cubePointsCnt;
@@ -1605,5 +2020,6 @@ void Engine3D::setLevel(Level* level)
 		this->assignedFlashLight = true;
 		this->flashLight = level->flashLight;
 	}
+	lightsDirty = true;
 	this->level = std::make_shared<Level>(*level);
 }
\ No newline at end of file
@@ -16,16 +16,32 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/vector_angle.hpp> // required for glm::angle
 
 #include "ArtificeShaderProgram.h"
 #include "Configuration.h"
 #include "Constructs3D.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "ModelStore.h"
+#include "OcclusionBuffer.h"
+#include "Collision.h"
+#include "ThreadPool.h"
+#include "UpdateScheduler.h"
+#include "PerfStats.h"
+#include "GLStateCache.h"
+#include "SceneSnapshot.h"
+#include "VertexArena.h"
+#include "StaticChunks.h"
+#include "TextureArrays.h"
+#include "IndirectDrawBuffer.h"
+#include "RenderQueue.h"
 #include "Light.h"
+#include "LightBuffer.h"
+#include "LightTiles.h"
+#include "LightVolumes.h"
 #include "Level.h"
 #include "EventController.h"
 #include "Preset.h"
-#include "Utility.h"
 
 #include <stdio.h>
 #include <iostream>
@@ -149,16 +165,35 @@ class Engine3D
 		ArtificeShaderProgram geometryShader;
 		ArtificeShaderProgram geometryCubemapShader;
 		ArtificeShaderProgram geometrySkyboxShader;
+		ArtificeShaderProgram occlusionShader;
+
+		//uniform handles of the shaders, resolved once they are loaded
+		geometryUniforms geometryShaderUniforms;
+		geometryUniforms geometryCubemapShaderUniforms;
+		geometryUniforms geometrySkyboxShaderUniforms;
+		typedef struct spotLightUniforms {
+			int position, direction, color, diffuseIntensity, specularIntensity, constant, linear, quadratic, cutoffDistance, cutoff, cutoffAngle, outerCutoff;
+		} spotLightUniforms;
+		spotLightUniforms flashLightUniforms;
+
+		//point and spot lights of the lighting shader, uploaded again only when the snapshot brings another set of lights
+		LightBuffer lightBuffer;
+		std::shared_ptr<const lightSet> uploadedLights = nullptr;
+		//point and spot lights binned per screen tile every frame, in the TILED lighting mode
+		LightTileGrid lightTiles;
+		//spheres and cones the point and spot lights are drawn with, in the VOLUMES lighting mode
+		LightVolumeMeshes lightVolumes;
+		ArtificeShaderProgram lightVolumeShader;
 		ArtificeShaderProgram lightingShader;
 		ArtificeShaderProgram postProcShader;
 
-		//textures, lightmaps, normalmaps, displacementmaps
+		//textures, lightmaps, normalmaps, displacementmaps, in texture arrays shared by the materials whose maps are alike
 		std::vector<std::string> texturePaths;
-		std::map<std::string, GLuint> textureIdsMap;
-		std::map<std::string, GLuint> lightmapIdsMap;
-		std::map<std::string, GLuint> normalmapIdsMap;
-		std::map<std::string, GLuint> displacementmapIdsMap;
+		TextureArrays textureArrays;
 		std::map<std::string, bool> textureTransparencyMap;
+		//textures with transparency, fixed once loaded, for the engine thread to leave their models out of the occluders
+		std::set<std::string> transparentTextures;
+		std::atomic<bool> areTexturesLoaded{ false };
 		std::vector<std::string> textureNames;
 
 		std::vector<std::string> cubemapPaths;
@@ -167,21 +202,31 @@ class Engine3D
 		std::map<std::string, GLuint> cubeNormalmapIdsMap;
 		std::map<std::string, GLuint> cubeDisplacementmapIdsMap;
 		std::vector<std::string> cubemapNames;
+		//the cubemaps of a name bound together, the draws carry the index of theirs plus one, fixed once loaded
+		typedef struct cubemapSet {
+			GLuint texture = 0;
+			GLuint lightmap = 0;
+			GLuint normalmap = 0;
+			GLuint displacementmap = 0;
+		} cubemapSet;
+		std::vector<cubemapSet> cubemapSets;
+		std::map<std::string, GLuint> cubemapSetIds;
+		cubemapSet noCubemaps;
 
 		//shader IDs
 		GLuint gGeometryProgramID = 0;
 		GLuint gGeometryCubemapProgramID = 0;
 		GLuint gGeometrySkyboxProgramID = 0;
+		GLuint gOcclusionProgramID = 0;
 		GLuint gLightingProgramID = 0;
+		GLuint gLightVolumeProgramID = 0;
 		GLuint gPostProcProgramID = 0;
 
-		//buffer object IDs
-		GLuint gVBO = 0;
-		GLuint gIBO = 0;
-		GLuint gVAO = 0;
-		GLuint gCubeVBO = 0;
-		GLuint gCubeIBO = 0;
-		GLuint gCubeVAO = 0;
+		//vertices of the models and of the cubes, each model owning a range that is uploaded again only when its mesh changes
+		VertexArena modelArena;
+		VertexArena cubeArena;
+		//models that never move, merged per material into chunks of the world drawn with one call each
+		StaticChunks staticChunks;
 
 		GLuint gBOMS = 0; //G-Buffer for MSAA
 		GLuint gPositionMS = 0; //position color buffer texture for MSAA
@@ -208,12 +253,103 @@ class Engine3D
 
 		float elapsedTime;
 
+		//fixed simulation step in seconds, 1 / SIMULATION_RATE
+		float simulationStep;
+
 		std::mutex mtx;
 
+		//snapshots of the scene published by the engine thread at the end of every tick and drawn by the rendering thread
+		TripleBuffer<sceneSnapshot> snapshots;
+
+		//camera published with the previous snapshot, interpolated by the rendering thread towards the current one
+		cameraState prevCameraState;
+
+		//lights shared by the published snapshots, copied again only when the editor changed them
+		std::shared_ptr<const lightSet> publishedLights = nullptr;
+		bool lightsDirty = true;
+
+		//occlusion query of a cube, issued on its bounding box after the geometry pass and used to skip drawing it in the next frame
+		typedef struct occlusionQuery {
+			GLuint id = 0;
+			bool isIssued = false; //false until the first query was issued, the cube is drawn before
+			unsigned long frame = 0; //last frame the cube was drawn in, its query is deleted once it is out of view
+		} occlusionQuery;
+		std::map<unsigned long, occlusionQuery> occlusionQueries;
+		unsigned long renderFrame = 0;
+
+		//models of the snapshot being rendered in draw order, grouped into instanced draws with the model matrices of all of them in one buffer
+		RenderQueue renderQueue;
+		InstanceBuffer instanceBuffer;
+		std::vector<drawBatch> cubeBatches;
+		//cubes with a query issued, drawn one at a time under the condition of their query
+		std::vector<drawBatch> queriedCubeBatches;
+		std::vector<drawBatch> opaqueBatches;
+		std::vector<drawBatch> chunkBatches;
+		//draw commands of the batches, in the order of the passes, when the context draws them indirectly
+		IndirectDrawBuffer indirectBuffer;
+		bool isIndirectDrawing = false;
+		std::vector<drawBatch> transparentBatches;
+		//OpenGL state of the rendering thread, the render methods set it through the cache so that redundant calls are dropped
+		GLStateCache glState;
+
+		//interpolated camera of the frame being rendered
+		glm::mat4 renderViewMatrix = glm::mat4(1.0f);
+		glm::vec3 renderCameraPos = glm::vec3(0.0f);
+
 		std::vector<model> modelsToRender;
 
 		std::vector<std::shared_ptr<model>> ptrModelsToRender;
 
+		//per-frame culling and collision state of the registered models, indexed by model handle
+		ModelStore modelStore;
+
+		//spatial index of the models, queried instead of iterating all of them every tick
+		BVH modelsBVH;
+
+		//skyboxes are always processed, so they are kept out of the BVH
+		std::vector<std::shared_ptr<model>> ptrSkyBoxes;
+
+		//models with speed, refreshed and refitted in the BVH every tick
+		std::vector<std::shared_ptr<model>> ptrMovingModels;
+
+		//models returned by the BVH query in the current and the previous tick, with their handles
+		std::vector<std::shared_ptr<model>> modelsInRange;
+		std::vector<std::shared_ptr<model>> prevModelsInRange;
+		std::vector<int> handlesInRange;
+		std::vector<int> prevHandlesInRange;
+
+		unsigned long updateTick = 0;
+
+		//view frustum of the current tick, tested against the bounding boxes of the models in range
+		frustum viewFrustum;
+		std::vector<unsigned char> visibilityInRange;
+
+		//per-model outputs of the parallel map phase of update(), reduced in candidate order afterwards
+		typedef struct modelUpdateResult {
+			bool isProcessed = false; //false if skipped this tick, focus is then left as is
+			bool isScheduled = false; //in view or near the person, so updated according to its tier
+			bool isUpdated = false; //due this tick, so clipped, focused and collided
+			updatetier tier = updatetier::EVERY_TICK;
+			bool isFocused = false;
+			bool canCollide = false; //near the person and touching its capsule
+			contact personContact;
+		} modelUpdateResult;
+		std::vector<modelUpdateResult> updateResults;
+
+		std::unique_ptr<ThreadPool> threadPool;
+
+		//software depth buffer the largest opaque models in view are rasterized into, to cull the models hidden behind them
+		std::unique_ptr<OcclusionBuffer> occlusionBuffer;
+		std::vector<size_t> occlusionCandidates;
+		std::vector<size_t> occluders;
+
+		//decides which of the models in range are updated in the current tick
+		UpdateScheduler updateScheduler;
+
+		//counters of the engine and the rendering thread, printed if PERF_STATS is enabled
+		PerfStats updateStats = PerfStats("update");
+		PerfStats renderStats = PerfStats("render");
+
 		int width;
 		int height;
 		float near;
@@ -233,6 +369,7 @@ class Engine3D
 		bool collidesBack = false;
 		bool collidesRight = false;
 		bool collidesLeft = false;
+		capsule personCapsule; //of the current tick, tested against the boxes of the models near the person
 
 		float gravitationalPull;
 		float jumpSpeedFactor;
@@ -256,17 +393,13 @@ class Engine3D
 		float pitch = 0;
 
 		struct ModelDistanceComparator {
-			bool operator()(const std::shared_ptr<model>& a, const std::shared_ptr<model>& b) const { return (a != b) ? a->position != b->position && a->distance < b->distance : a.get() < b.get(); };
+			const ModelStore* store;
+			bool operator()(const std::shared_ptr<model>& a, const std::shared_ptr<model>& b) const { return (a != b) ? a->position != b->position && store->distance[a->handle] < store->distance[b->handle] : a.get() < b.get(); };
 		};
-		struct ModelDescendingDistanceComparator {
-			bool operator()(const std::shared_ptr<model>& a, const std::shared_ptr<model>& b) const { return (a != b) ?  a->position != b->position && a->distance > b->distance : a.get() > b.get(); };
-		};
-		std::set<std::shared_ptr<model>, ModelDistanceComparator> modelsInFocus;
+		std::set<std::shared_ptr<model>, ModelDistanceComparator> modelsInFocus{ ModelDistanceComparator{ &modelStore } };
 
-		std::shared_ptr<cubeModel> finalSkyBoxToRender = nullptr;
 		std::set<std::shared_ptr<model>> finalCubeModelsToRender;
 		std::set<std::shared_ptr<model>> finalModelsToRender;
-		std::set<std::shared_ptr<model>, ModelDescendingDistanceComparator> finalTransparentModelsToRender;
 
 		glm::vec3 lightPos;
 
@@ -358,13 +491,64 @@ class Engine3D
 
 		void engineLoop();
 
+		void publishSnapshot();
+
+		//gives the draw of the model the ids of its cubemaps or of its material in the texture arrays
+		void resolveMaterial(drawItem& item, const model& m) const;
+
+		//the cubemaps of the set a draw carries, none for 0
+		const cubemapSet& getCubemapSet(GLuint id) const;
+
+		//finds the ranges of the items again after the arenas gave ranges back or moved them since the snapshot was published,
+		//leaving out the items whose meshes are gone
+		void relocateItems(sceneSnapshot& snapshot);
+
+		void interpolateCameraState(const sceneSnapshot& snapshot);
+
+		void issueOcclusionQueries(const sceneSnapshot& snapshot);
+
+		//true if a query of the bounding box of the cube was issued in an earlier frame, so that the GPU can skip drawing the cube on its result
+		bool isQueried(unsigned long id) const;
+
+		//groups the sorted draws of a pass into batches of instances, appending their model matrices to the instance buffer
+		void batchItems(RenderQueue::renderPass pass, std::vector<drawBatch>& batches);
+
+		//appends a draw command per batch to the indirect buffer, returns the index of the first
+		size_t pushCommands(const std::vector<drawBatch>& batches);
+
+		//draws the batches in order, binding textures only when they differ from the previous batch
+		//drawing indirectly, the batches up to the next change of textures or state go in one call, from the commands starting at firstCommand
+		//conditional batches are cubes drawn directly, each only if its occlusion query passed samples, without reading the result back
+		void submitBatches(const std::vector<drawBatch>& batches, ArtificeShaderProgram& shader, const geometryUniforms& u, GLuint vao, GLuint ibo, size_t firstCommand = 0, bool isConditional = false);
+
+		//true if the items bind the same textures, cull the same faces and have the same frame grid
+		bool isDrawnWith(const drawItem& a, const drawItem& b) const;
+
+		//enables or disables face culling through the state cache, counting the calls it does not drop
+		void setCullFace(bool isEnabled);
+
+		//binds the textures of the geometry buffer to the units 0 to 4
+		void bindGBuffer();
+
+		//sets the sampler uniforms of the bound program to their fixed texture units, once after it is loaded
+		void setMaterialSamplers(ArtificeShaderProgram& shader);
+		void setGBufferSamplers(ArtificeShaderProgram& shader);
+
+		//adds the point and spot lights to the lighting buffer, each drawn as the volume it can reach
+		void renderLightVolumes(const sceneSnapshot& snapshot);
+
+		spotLightUniforms resolveSpotLightUniforms(const std::string& name) const;
+
+		//locks the mutex shared with the editor and the vertex upload, counting in stats if it had to wait
+		void lockCounted(PerfStats& stats);
+
 		std::thread startRendering();
 
 		void renderingLoop();
 
 		bool initGL();
 
-		void loadTextures(std::map<std::string, GLuint>& textureIdsMap, std::map<std::string, GLuint>& lightmapIdsMap, std::map<std::string, GLuint>& normalmapIdsMap, std::map<std::string, GLuint>& displacementmapIdsMap);
+		void loadTextures();
 
 		void loadCubemaps(std::map<std::string, GLuint>& cubemapIdsMap, std::map<std::string, GLuint>& cubeLightmapIdsMap, std::map<std::string, GLuint>& cubeNormalmapIdsMap, std::map<std::string, GLuint>& cubeDisplacementmapIdsMap);
 
@@ -378,14 +562,20 @@ class Engine3D
 
 		//void renderUI();
 
-		bool isInFOV(model& m);
+		void updateModelInRange(size_t i, const glm::mat4& viewProjectionMatrix, const std::shared_ptr<model>& editing);
 
 		void captureInput();
 
-		void markCoveredModels();
+		void cullOccludedModels(const glm::mat4& viewProjectionMatrix);
 
 		void move(float elapsedTime);
 
+		void registerModel(std::shared_ptr<model> m);
+
+		void unregisterModel(std::shared_ptr<model> m);
+
+		void refitModel(std::shared_ptr<model> m);
+
 		//editor user mode specific
 
 		void addModel(float editingWidth, float editingHeight, float editingDepth, float editingRotationX, float editingRotationY, float editingRotationZ, unsigned int editingCubemapNameIndex, unsigned int editingTextureNameIndex, bool editingIsSolid, shapetype type, glm::vec3 position);
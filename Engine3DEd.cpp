@@ -11,6 +11,7 @@ void Engine3D::addModel(float editingWidth, float editingHeight, float editingDe
 		mtx.lock();
 		ptrModelsToRender.push_back(std::make_shared<cubeModel>(mdl));
 		editingModel = ptrModelsToRender.back();
+		registerModel(editingModel);
 		std::cout << "placed model has sn = " << editingModel->sn << std::endl;
 		mtx.unlock();
 	} else
@@ -32,6 +33,7 @@ void Engine3D::addModel(float editingWidth, float editingHeight, float editingDe
 		mtx.lock();
 		ptrModelsToRender.push_back(std::make_shared<model>(m));
 		editingModel = ptrModelsToRender.back();
+		registerModel(editingModel);
 		std::cout << "placed model has sn = " << editingModel->sn << std::endl;
 		mtx.unlock();
 	}
@@ -48,6 +50,7 @@ void Engine3D::addLightHandleModel(unsigned long id, glm::vec3 position, glm::ma
 	mtx.lock();
 	ptrModelsToRender.push_back(std::make_shared<model>(m));
 	editingModel = ptrModelsToRender.back();
+	registerModel(editingModel);
 	std::cout << "placed model has sn = " << editingModel->sn << std::endl;
 	mtx.unlock();
 }
@@ -56,22 +59,23 @@ void Engine3D::addModel(model& mdl)
 {
 	mdl.id = getTimeSinceEpoch();
 	std::cout << "about to place cube model with id = " << mdl.id << std::endl;
+	//the copy keeps the ranges of the model it was made from, the snapshots leave it out until the arena uploads its own
 	if (mdl.modelMesh.shape == shapetype::CUBE)
 	{
-		mdl.sn = cubePointsCnt;
 		cubePointsCnt += mdl.modelMesh.tris.size() * 3;
 		mtx.lock();
 		ptrModelsToRender.push_back(std::make_shared<cubeModel>(mdl));
 		editingModel = ptrModelsToRender.back();
+		registerModel(editingModel);
 		std::cout << "placed model has sn = " << editingModel->sn << std::endl;
 		mtx.unlock();
 	} else
 	{
-		mdl.sn = modelPointsCnt;
 		modelPointsCnt += mdl.modelMesh.tris.size() * 3;
 		mtx.lock();
 		ptrModelsToRender.push_back(std::make_shared<model>(mdl));
 		editingModel = ptrModelsToRender.back();
+		registerModel(editingModel);
 		std::cout << "placed model has sn = " << editingModel->sn << std::endl;
 		mtx.unlock();
 	}
@@ -87,6 +91,7 @@ void Engine3D::removeModel(std::shared_ptr<model> m)
 		if (ptrModelsToRender[i]->removeFlag) break;
 	}
 	unsigned long removeIndex = i;
+	unregisterModel(m);
 	std::cout << "removing model with index = " << i << " and sn = " << ptrModelsToRender[i]->sn << std::endl;
 	if (m->modelMesh.shape == shapetype::CUBE)
 	{
@@ -95,14 +100,7 @@ void Engine3D::removeModel(std::shared_ptr<model> m)
 	{
 		modelPointsCnt -= m->modelMesh.tris.size() * 3;
 	}
-	for (i+=1; i < ptrModelsToRender.size(); i++)
-	{
-		if ((m->modelMesh.shape == shapetype::CUBE && ptrModelsToRender[i]->modelMesh.shape == shapetype::CUBE) ||
-			(m->modelMesh.shape != shapetype::CUBE && ptrModelsToRender[i]->modelMesh.shape != shapetype::CUBE))
-		{
-			ptrModelsToRender[i]->sn -= m->modelMesh.tris.size() * 3;
-		}
-	}
+	//the vertices of the model stay where they are until the vertex arena gives its range back, the other models keep theirs
 	ptrModelsToRender[removeIndex].reset();
 	ptrModelsToRender.erase(ptrModelsToRender.begin() + removeIndex);
 	m.reset();
@@ -212,10 +210,11 @@ void Engine3D::edit(float elapsedTime)
 			// if there is a spawned model about to be placed
 			if (editingModel != nullptr) {
 				//real-time update of position and rotation
-				editingModel->position = personPos + (editingDepth + originalCollidingDistanceH) * personFront;
+				editingModel->setPosition(personPos + (editingDepth + originalCollidingDistanceH) * personFront);
 				editingModel->rotationMatrix[0] = glm::vec4(getCameraRight(), 0.0f);
 				editingModel->rotationMatrix[1] = glm::vec4(glm::normalize(glm::cross(getCameraFront(), getCameraRight())), 0.0f);
 				editingModel->rotationMatrix[2] = glm::vec4(-getCameraFront(), 0.0f);
+				editingModel->markDirty();
 			}
 			// if left mouse released, place a point or spot light in the scene
 			if (editingModel != nullptr && !keysPressed[SupportedKeys::MOUSE_LEFT_CLICK]) {
@@ -224,8 +223,7 @@ void Engine3D::edit(float elapsedTime)
 					pointLight.id = editingModel->id;
 					pointLight.position = editingModel->position;
 					pointLights.push_back(pointLight);
-					// edit the lighting shader to reflect the number of point lights
-					Utility::replaceLineInFile("shaders/lighting.glfs", 7, "#define NR_POINT_LIGHTS " + std::to_string(pointLights.size()));
+					lightsDirty = true;
 					removeModel(ptrModelsToRender.back());
 					addLightHandleModel(editingModel->id, editingModel->position, editingModel->rotationMatrix);
 					editingModel = nullptr;
@@ -238,8 +236,7 @@ void Engine3D::edit(float elapsedTime)
 					spotLight.position = editingModel->position;
 					spotLight.direction = glm::normalize(personFront);
 					spotLights.push_back(spotLight);
-					// edit the lighting shader to reflect the number of spot lights
-					Utility::replaceLineInFile("shaders/lighting.glfs", 10, "#define NR_SPOT_LIGHTS " + std::to_string(spotLights.size()));
+					lightsDirty = true;
 					removeModel(ptrModelsToRender.back());
 					addLightHandleModel(editingModel->id, editingModel->position, editingModel->rotationMatrix);
 					editingModel = nullptr;
@@ -252,11 +249,13 @@ void Engine3D::edit(float elapsedTime)
 			if (keysPressed[SupportedKeys::MOUSE_LEFT_CLICK] && !prevKeysPressed[SupportedKeys::MOUSE_LEFT_CLICK]) {
 				if (lightingTypeOptions[lightingTypeOptionIndex] == "directional" && preset.getDirectionalLights().size() > 0) {
 					light = selectedLight;
+					lightsDirty = true;
 					std::cout << "placed preset directional light: " << light.name << std::endl;
 				}
 			}
 
 			if (eventController->flashlight(keysPressed, prevKeysPressed)) {
+				lightsDirty = true;
 				if (lightingTypeOptions[lightingTypeOptionIndex] == "point") {
 					if (assignedFlashLight && flashLight.name == pointLight.name) {
 						assignedFlashLight = false;
@@ -294,14 +293,13 @@ void Engine3D::edit(float elapsedTime)
 				for (auto it = pointLights.begin(); it != pointLights.end(); ++it) {
 					if ( it->id == deletingModel->id ) {
 						pointLights.erase(it);
+						lightsDirty = true;
 						std::cout << "removed point light with id = " << deletingModel->id << std::endl;
 						removeModel(deletingModel);
 						deletingModel.reset();
 						isEdited = true;
 						std::cout << "also removed light handle model" << std::endl;
 						found = true;
-						// edit the lighting shader to reflect the number of point lights
-						Utility::replaceLineInFile("shaders/lighting.glfs", 7, "#define NR_POINT_LIGHTS " + std::to_string(pointLights.size()));
 						break;
 					}
 				}
@@ -309,14 +307,13 @@ void Engine3D::edit(float elapsedTime)
 					for (auto it = spotLights.begin(); it != spotLights.end(); ++it) {
 						if ( it->id == deletingModel->id ) {
 							spotLights.erase(it);
+							lightsDirty = true;
 							std::cout << "removed spot light with id = " << deletingModel->id << std::endl;
 							removeModel(deletingModel);
 							deletingModel.reset();
 							isEdited = true;
 							std::cout << "also removed light handle model" << std::endl;
 							found = true;
-							// edit the lighting shader to reflect the number of spot lights
-							Utility::replaceLineInFile("shaders/lighting.glfs", 10, "#define NR_SPOT_LIGHTS " + std::to_string(spotLights.size()));
 							break;
 						}
 					}
@@ -490,7 +487,7 @@ void Engine3D::edit(float elapsedTime)
 		// there is a spawned model about to be placed
 		if (editingModel != nullptr) {
 			//real-time update of transformation, texture and isSolid
-			editingModel->position = personPos + (editingDepth + originalCollidingDistanceH) * personFront;
+			editingModel->setPosition(personPos + (editingDepth + originalCollidingDistanceH) * personFront);
 			editingModel->rotate(editingRotationX, editingRotationY, editingRotationZ);
 			editingModel->scale(editingWidth, editingHeight, editingDepth);
 			editingModel->texture = editingModel->modelMesh.shape == shapetype::CUBE ? cubemapNames[editingCubemapNameIndex] : textureNames[editingTextureNameIndex];
@@ -536,8 +533,8 @@ void Engine3D::edit(float elapsedTime)
 			m.position = personPos + (editingDepth + originalCollidingDistanceH) * personFront;
 			if (!modelsInFocus.empty()) {
 				auto modelInFocus = *(modelsInFocus.begin());
-				//std::cout << "model in focus id: " << modelInFocus->id << ", editing model id: " << editingModel->id << ", distance: " << modelInFocus->distance << ", editingDepth: " << editingDepth << ", originalCollidingDistanceH: " << originalCollidingDistanceH << std::endl;
-				if (modelInFocus->id != editingModel->id && modelInFocus->distance < editingDepth + originalCollidingDistanceH) {
+				//std::cout << "model in focus id: " << modelInFocus->id << ", editing model id: " << editingModel->id << ", distance: " << modelStore.distance[modelInFocus->handle] << ", editingDepth: " << editingDepth << ", originalCollidingDistanceH: " << originalCollidingDistanceH << std::endl;
+				if (modelInFocus->id != editingModel->id && modelStore.distance[modelInFocus->handle] < editingDepth + originalCollidingDistanceH) {
 					std::cout << "snapping to model in focus!" << std::endl;
 					m.snapTo(getCameraFront(), modelInFocus);
 				}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "Constructs3D.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+//world-space bounding boxes laid out as structure of arrays, to be frustum-tested in batches
+typedef struct aabbBatch
+{
+	std::vector<float> minX, maxX, minY, maxY, minZ, maxZ;
+
+	void clear()
+	{
+		minX.clear(); maxX.clear(); minY.clear(); maxY.clear(); minZ.clear(); maxZ.clear();
+	}
+
+	void push(const boundingbox& b)
+	{
+		minX.push_back(b.minX); maxX.push_back(b.maxX);
+		minY.push_back(b.minY); maxY.push_back(b.maxY);
+		minZ.push_back(b.minZ); maxZ.push_back(b.maxZ);
+	}
+
+	void resize(size_t count)
+	{
+		minX.resize(count); maxX.resize(count); minY.resize(count); maxY.resize(count); minZ.resize(count); maxZ.resize(count);
+	}
+
+	void set(size_t i, const boundingbox& b)
+	{
+		minX[i] = b.minX; maxX[i] = b.maxX;
+		minY[i] = b.minY; maxY[i] = b.maxY;
+		minZ[i] = b.minZ; maxZ[i] = b.maxZ;
+	}
+
+	boundingbox get(size_t i) const
+	{
+		return { minX[i], maxX[i], minY[i], maxY[i], minZ[i], maxZ[i] };
+	}
+
+	size_t size() const { return minX.size(); }
+
+} aabbBatch;
+
+
+//view frustum as six planes (left, right, bottom, top, near, far) with normals pointing inwards
+typedef struct frustum
+{
+	glm::vec4 planes[6];
+
+	frustum() {}
+
+	frustum(const glm::mat4& viewProjection) { extract(viewProjection); }
+
+	//extracts the planes from the rows of the view-projection matrix (Gribb/Hartmann)
+	void extract(const glm::mat4& m)
+	{
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+		planes[0] = row3 + row0;
+		planes[1] = row3 - row0;
+		planes[2] = row3 + row1;
+		planes[3] = row3 - row1;
+		planes[4] = row3 + row2;
+		planes[5] = row3 - row2;
+		for (int i = 0; i < 6; i++)
+		{
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+
+	//true if the box intersects or is inside the frustum, tests the box corner furthest along each plane normal
+	bool intersects(const boundingbox& b) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			const glm::vec4& p = planes[i];
+			float x = p.x >= 0.0f ? b.maxX : b.minX;
+			float y = p.y >= 0.0f ? b.maxY : b.minY;
+			float z = p.z >= 0.0f ? b.maxZ : b.minZ;
+			if (p.x * x + p.y * y + p.z * z + p.w < 0.0f) return false;
+		}
+		return true;
+	}
+
+	//tests the boxes at the given indices of a batch, writes 1 to visible[i] if box indices[i] intersects the frustum, 0 otherwise
+	void intersects(const aabbBatch& boxes, const int* indices, size_t count, unsigned char* visible) const
+	{
+		size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			int a = indices[i], b = indices[i + 1], c = indices[i + 2], d = indices[i + 3];
+			__m128 minX = _mm_setr_ps(boxes.minX[a], boxes.minX[b], boxes.minX[c], boxes.minX[d]);
+			__m128 maxX = _mm_setr_ps(boxes.maxX[a], boxes.maxX[b], boxes.maxX[c], boxes.maxX[d]);
+			__m128 minY = _mm_setr_ps(boxes.minY[a], boxes.minY[b], boxes.minY[c], boxes.minY[d]);
+			__m128 maxY = _mm_setr_ps(boxes.maxY[a], boxes.maxY[b], boxes.maxY[c], boxes.maxY[d]);
+			__m128 minZ = _mm_setr_ps(boxes.minZ[a], boxes.minZ[b], boxes.minZ[c], boxes.minZ[d]);
+			__m128 maxZ = _mm_setr_ps(boxes.maxZ[a], boxes.maxZ[b], boxes.maxZ[c], boxes.maxZ[d]);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int j = 0; j < 6; j++)
+			{
+				const glm::vec4& p = planes[j];
+				__m128 x = p.x >= 0.0f ? maxX : minX;
+				__m128 y = p.y >= 0.0f ? maxY : minY;
+				__m128 z = p.z >= 0.0f ? maxZ : minZ;
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), x), _mm_mul_ps(_mm_set1_ps(p.y), y)),
+										 _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), z), _mm_set1_ps(p.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+			}
+			int mask = _mm_movemask_ps(inside);
+			visible[i]     = (mask >> 0) & 1;
+			visible[i + 1] = (mask >> 1) & 1;
+			visible[i + 2] = (mask >> 2) & 1;
+			visible[i + 3] = (mask >> 3) & 1;
+		}
+#endif
+		for (; i < count; i++)
+		{
+			visible[i] = intersects(boxes.get(indices[i])) ? 1 : 0;
+		}
+	}
+
+} frustum;
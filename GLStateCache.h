@@ -0,0 +1,216 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <unordered_map>
+
+//remembers the OpenGL state set through it on the rendering thread and drops the calls that would set it to what it already is
+//state is unknown until set through the cache, after OpenGL calls made around it (vertex uploads, UI) invalidate() forgets everything
+class GLStateCache
+{
+	public:
+
+		static const unsigned int TEXTURE_UNITS = 16;
+
+		GLStateCache()
+		{
+			invalidate();
+		}
+
+		void invalidate()
+		{
+			program = UNKNOWN;
+			vertexArray = UNKNOWN;
+			arrayBuffer = UNKNOWN;
+			drawIndirectBuffer = UNKNOWN;
+			elementBuffers.clear();
+			activeUnit = UNKNOWN;
+			for (unsigned int unit = 0; unit < TEXTURE_UNITS; unit++)
+			{
+				for (unsigned int t = 0; t < TEXTURE_TARGETS; t++) textures[unit][t] = UNKNOWN;
+			}
+			for (unsigned int c = 0; c < CAPABILITIES; c++) enabled[c] = -1;
+			blendSrc = blendDst = UNKNOWN;
+			depthFuncValue = UNKNOWN;
+			cullFaceMode = UNKNOWN;
+			depthMaskValue = -1;
+			colorMaskValue = -1;
+		}
+
+		void useProgram(GLuint id)
+		{
+			if (changes(program, id)) glUseProgram(id);
+		}
+
+		void bindVertexArray(GLuint id)
+		{
+			if (changes(vertexArray, id)) glBindVertexArray(id);
+		}
+
+		//the element buffer binding belongs to the bound vertex array, so it is remembered per vertex array
+		void bindElementBuffer(GLuint id)
+		{
+			auto itr = elementBuffers.find(vertexArray);
+			if (vertexArray != UNKNOWN && itr != elementBuffers.end() && itr->second == id)
+			{
+				skippedCnt++;
+				return;
+			}
+			issuedCnt++;
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+			if (vertexArray != UNKNOWN) elementBuffers[vertexArray] = id;
+		}
+
+		void bindArrayBuffer(GLuint id)
+		{
+			if (changes(arrayBuffer, id)) glBindBuffer(GL_ARRAY_BUFFER, id);
+		}
+
+		void bindDrawIndirectBuffer(GLuint id)
+		{
+			if (changes(drawIndirectBuffer, id)) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id);
+		}
+
+		//binds a texture to a unit given by its index, 0 for GL_TEXTURE0
+		void bindTexture(GLuint unit, GLenum target, GLuint id)
+		{
+			int t = targetIndex(target);
+			if (unit < TEXTURE_UNITS && t >= 0 && textures[unit][t] == id)
+			{
+				skippedCnt++;
+				return;
+			}
+			if (changes(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+			issuedCnt++;
+			glBindTexture(target, id);
+			if (unit < TEXTURE_UNITS && t >= 0) textures[unit][t] = id;
+		}
+
+		//glEnable or glDisable, for the capabilities the renderer switches, returns true if the call was issued
+		bool setEnabled(GLenum capability, bool isEnabled)
+		{
+			int c = capabilityIndex(capability);
+			if (c >= 0 && enabled[c] == (isEnabled ? 1 : 0))
+			{
+				skippedCnt++;
+				return false;
+			}
+			issuedCnt++;
+			if (isEnabled) glEnable(capability);
+			else glDisable(capability);
+			if (c >= 0) enabled[c] = isEnabled ? 1 : 0;
+			return true;
+		}
+
+		void blendFunc(GLenum src, GLenum dst)
+		{
+			if (blendSrc == src && blendDst == dst)
+			{
+				skippedCnt++;
+				return;
+			}
+			issuedCnt++;
+			glBlendFunc(src, dst);
+			blendSrc = src;
+			blendDst = dst;
+		}
+
+		void depthFunc(GLenum func)
+		{
+			if (changes(depthFuncValue, func)) glDepthFunc(func);
+		}
+
+		void cullFace(GLenum mode)
+		{
+			if (changes(cullFaceMode, mode)) glCullFace(mode);
+		}
+
+		void depthMask(bool isWritten)
+		{
+			if (changes(depthMaskValue, isWritten ? 1 : 0)) glDepthMask(isWritten ? GL_TRUE : GL_FALSE);
+		}
+
+		void colorMask(bool isWritten)
+		{
+			GLboolean mask = isWritten ? GL_TRUE : GL_FALSE;
+			if (changes(colorMaskValue, isWritten ? 1 : 0)) glColorMask(mask, mask, mask, mask);
+		}
+
+		//calls issued and dropped since the last call, for the performance counters
+		unsigned long takeIssuedCnt()
+		{
+			unsigned long cnt = issuedCnt;
+			issuedCnt = 0;
+			return cnt;
+		}
+
+		unsigned long takeSkippedCnt()
+		{
+			unsigned long cnt = skippedCnt;
+			skippedCnt = 0;
+			return cnt;
+		}
+
+	private:
+
+		static const GLuint UNKNOWN = 0xFFFFFFFF;
+		static const unsigned int TEXTURE_TARGETS = 4;
+		static const unsigned int CAPABILITIES = 6;
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint arrayBuffer;
+		GLuint drawIndirectBuffer;
+		std::unordered_map<GLuint, GLuint> elementBuffers;
+		GLuint activeUnit;
+		GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+		signed char enabled[CAPABILITIES];
+		GLenum blendSrc, blendDst;
+		GLenum depthFuncValue;
+		GLenum cullFaceMode;
+		int depthMaskValue;
+		int colorMaskValue;
+		unsigned long issuedCnt = 0;
+		unsigned long skippedCnt = 0;
+
+		//true and counted as issued if the value differs from the remembered one, which it then replaces
+		template <typename T> bool changes(T& remembered, T value)
+		{
+			if (remembered == value)
+			{
+				skippedCnt++;
+				return false;
+			}
+			remembered = value;
+			issuedCnt++;
+			return true;
+		}
+
+		static int targetIndex(GLenum target)
+		{
+			switch (target)
+			{
+				case GL_TEXTURE_2D: return 0;
+				case GL_TEXTURE_CUBE_MAP: return 1;
+				case GL_TEXTURE_BUFFER: return 2;
+				case GL_TEXTURE_2D_ARRAY: return 3;
+				default: return -1;
+			}
+		}
+
+		static int capabilityIndex(GLenum capability)
+		{
+			switch (capability)
+			{
+				case GL_BLEND: return 0;
+				case GL_DEPTH_TEST: return 1;
+				case GL_CULL_FACE: return 2;
+				case GL_DEPTH_CLAMP: return 3;
+				case GL_POLYGON_OFFSET_FILL: return 4;
+				case GL_MULTISAMPLE: return 5;
+				default: return -1;
+			}
+		}
+
+};
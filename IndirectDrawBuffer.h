@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include "GLStateCache.h"
+#include <cstddef>
+#include <vector>
+
+//draw commands of the instanced draws of one frame, streamed into one indirect buffer every frame, so that runs of draws sharing
+//their textures and state go to the GPU in one glMultiDrawElementsIndirect call (OpenGL 4.3 or ARB_multi_draw_indirect):
+//the base instance of a command points the instance attributes at its instances, which needs ARB_base_instance as well
+class IndirectDrawBuffer
+{
+	public:
+
+		//laid out as OpenGL reads it
+		typedef struct command
+		{
+			GLuint indexCount;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		} command;
+
+		//true if the context can draw from the buffer, needs glewInit() to have run
+		static bool isSupported()
+		{
+			return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+		}
+
+		void clear()
+		{
+			commands.clear();
+		}
+
+		//appends a command, returns its index
+		size_t push(GLuint indexCount, GLuint instanceCount, GLuint firstIndex, GLint baseVertex, GLuint baseInstance)
+		{
+			commands.push_back({ indexCount, instanceCount, firstIndex, baseVertex, baseInstance });
+			return commands.size() - 1;
+		}
+
+		size_t size() const
+		{
+			return commands.size();
+		}
+
+		//replaces the store of the buffer with the commands pushed since the last clear, needs the OpenGL context
+		void upload(GLStateCache& gl)
+		{
+			if (buffer == 0) glGenBuffers(1, &buffer);
+			gl.bindDrawIndirectBuffer(buffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(command), commands.data(), GL_STREAM_DRAW);
+		}
+
+		//draws the given run of commands with the bound vertex array
+		void draw(GLStateCache& gl, size_t firstCommand, GLsizei commandCount) const
+		{
+			gl.bindDrawIndirectBuffer(buffer);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(firstCommand * sizeof(command)), commandCount, 0);
+		}
+
+		void free()
+		{
+			if (buffer) glDeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+
+	private:
+
+		GLuint buffer = 0;
+		std::vector<command> commands;
+
+};
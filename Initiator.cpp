@@ -104,6 +104,12 @@ void Initiator::loadConfiguration()
  				} else if (tokens[0] == "PHONG_LIGHTING") {
 					cfg->PHONG_LIGHTING = tokens[1] == "true";
 					std::cout << "PHONG_LIGHTING = " << cfg->PHONG_LIGHTING << std::endl;
+				} else if (tokens[0] == "LIGHTING_MODE") {
+					cfg->LIGHTING_MODE = tokens[1] == "FULLSCREEN" ? LightingMode::FULLSCREEN : tokens[1] == "VOLUMES" ? LightingMode::VOLUMES : LightingMode::TILED;
+					std::cout << "LIGHTING_MODE = " << cfg->LIGHTING_MODE << std::endl;
+				} else if (tokens[0] == "LIGHTING_TILE_SIZE") {
+					cfg->LIGHTING_TILE_SIZE = std::stoi(tokens[1]);
+					std::cout << "LIGHTING_TILE_SIZE = " << cfg->LIGHTING_TILE_SIZE << std::endl;
  				} else if (tokens[0] == "LIGHT_MAPPING") {
 					cfg->LIGHT_MAPPING = tokens[1] == "true";
 					std::cout << "LIGHT_MAPPING = " << cfg->LIGHT_MAPPING << std::endl;
@@ -141,6 +147,51 @@ void Initiator::loadConfiguration()
 				} else if (tokens[0] == "PERSON_WIDTH") {
 					cfg->PERSON_WIDTH = std::stof(tokens[1]);
 					std::cout << "PERSON_WIDTH = " << cfg->PERSON_WIDTH << std::endl;
+				} else if (tokens[0] == "SIMULATION_RATE") {
+					cfg->SIMULATION_RATE = std::stoi(tokens[1]);
+					std::cout << "SIMULATION_RATE = " << cfg->SIMULATION_RATE << std::endl;
+				} else if (tokens[0] == "MAX_SUBSTEPS") {
+					cfg->MAX_SUBSTEPS = std::stoi(tokens[1]);
+					std::cout << "MAX_SUBSTEPS = " << cfg->MAX_SUBSTEPS << std::endl;
+				} else if (tokens[0] == "WORKER_THREADS") {
+					cfg->WORKER_THREADS = std::stoi(tokens[1]);
+					std::cout << "WORKER_THREADS = " << cfg->WORKER_THREADS << std::endl;
+				} else if (tokens[0] == "UPDATE_TIER_NEAR") {
+					cfg->UPDATE_TIER_NEAR = std::stof(tokens[1]);
+					std::cout << "UPDATE_TIER_NEAR = " << cfg->UPDATE_TIER_NEAR << std::endl;
+				} else if (tokens[0] == "UPDATE_TIER_FAR") {
+					cfg->UPDATE_TIER_FAR = std::stof(tokens[1]);
+					std::cout << "UPDATE_TIER_FAR = " << cfg->UPDATE_TIER_FAR << std::endl;
+				} else if (tokens[0] == "UPDATE_TIER_INTERVAL") {
+					cfg->UPDATE_TIER_INTERVAL = std::stoi(tokens[1]);
+					std::cout << "UPDATE_TIER_INTERVAL = " << cfg->UPDATE_TIER_INTERVAL << std::endl;
+				} else if (tokens[0] == "UPDATE_CELL_SIZE") {
+					cfg->UPDATE_CELL_SIZE = std::stof(tokens[1]);
+					std::cout << "UPDATE_CELL_SIZE = " << cfg->UPDATE_CELL_SIZE << std::endl;
+				} else if (tokens[0] == "OCCLUSION_CULLING") {
+					cfg->OCCLUSION_CULLING = tokens[1] == "true";
+					std::cout << "OCCLUSION_CULLING = " << cfg->OCCLUSION_CULLING << std::endl;
+				} else if (tokens[0] == "OCCLUSION_BUFFER_WIDTH") {
+					cfg->OCCLUSION_BUFFER_WIDTH = std::stoi(tokens[1]);
+					std::cout << "OCCLUSION_BUFFER_WIDTH = " << cfg->OCCLUSION_BUFFER_WIDTH << std::endl;
+				} else if (tokens[0] == "OCCLUSION_BUFFER_HEIGHT") {
+					cfg->OCCLUSION_BUFFER_HEIGHT = std::stoi(tokens[1]);
+					std::cout << "OCCLUSION_BUFFER_HEIGHT = " << cfg->OCCLUSION_BUFFER_HEIGHT << std::endl;
+				} else if (tokens[0] == "OCCLUSION_OCCLUDERS") {
+					cfg->OCCLUSION_OCCLUDERS = std::stoi(tokens[1]);
+					std::cout << "OCCLUSION_OCCLUDERS = " << cfg->OCCLUSION_OCCLUDERS << std::endl;
+				} else if (tokens[0] == "OCCLUSION_QUERIES") {
+					cfg->OCCLUSION_QUERIES = tokens[1] == "true";
+					std::cout << "OCCLUSION_QUERIES = " << cfg->OCCLUSION_QUERIES << std::endl;
+				} else if (tokens[0] == "MULTI_DRAW_INDIRECT") {
+					cfg->MULTI_DRAW_INDIRECT = tokens[1] == "true";
+					std::cout << "MULTI_DRAW_INDIRECT = " << cfg->MULTI_DRAW_INDIRECT << std::endl;
+				} else if (tokens[0] == "STATIC_CHUNK_SIZE") {
+					cfg->STATIC_CHUNK_SIZE = std::stof(tokens[1]);
+					std::cout << "STATIC_CHUNK_SIZE = " << cfg->STATIC_CHUNK_SIZE << std::endl;
+				} else if (tokens[0] == "PERF_STATS") {
+					cfg->PERF_STATS = tokens[1] == "true";
+					std::cout << "PERF_STATS = " << cfg->PERF_STATS << std::endl;
 				} else if (tokens[0] == "MOUSE_SENSITIVITY_X") {
 					cfg->MOUSE_SENSITIVITY_X = std::stof(tokens[1]);
 					std::cout << "MOUSE_SENSITIVITY_X = " << cfg->MOUSE_SENSITIVITY_X << std::endl;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include "GLStateCache.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+//per-instance attributes of the geometry shaders, streamed into one vertex buffer every frame:
+//locations 5 to 8 are the columns of the model matrix, location 9 is the animation frame index,
+//location 10 the layer of the material in its texture arrays and the bits of the maps it has
+class InstanceBuffer
+{
+	public:
+
+		static const GLuint MODEL_MATRIX_LOCATION = 5;
+		static const GLuint FRAME_INDEX_LOCATION = 9;
+		static const GLuint MATERIAL_LOCATION = 10;
+
+		typedef struct instance
+		{
+			glm::mat4 modelMatrix;
+			GLint frameIndex;
+			GLint material[2]; //layer and maps
+		} instance;
+
+		void clear()
+		{
+			instances.clear();
+		}
+
+		//appends an instance, returns its index
+		size_t push(const glm::mat4& modelMatrix, GLint frameIndex, GLint layer = 0, GLint maps = 0)
+		{
+			instances.push_back({ modelMatrix, frameIndex, { layer, maps } });
+			return instances.size() - 1;
+		}
+
+		size_t size() const
+		{
+			return instances.size();
+		}
+
+		//replaces the store of the buffer with the instances pushed since the last clear, needs the OpenGL context
+		void upload(GLStateCache& gl)
+		{
+			if (buffer == 0) glGenBuffers(1, &buffer);
+			gl.bindArrayBuffer(buffer);
+			glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(instance), instances.data(), GL_STREAM_DRAW);
+		}
+
+		//points the instance attributes of the bound vertex array at the instances starting at the given one
+		//OpenGL 3.3 has no base instance for instanced draws, so every batch moves the attribute offsets instead,
+		//but indirect draws point them at the first instance and give every command its base instance
+		void bindAttributes(GLStateCache& gl, size_t firstInstance) const
+		{
+			gl.bindArrayBuffer(buffer);
+			size_t base = firstInstance * sizeof(instance);
+			for (GLuint column = 0; column < 4; column++)
+			{
+				GLuint location = MODEL_MATRIX_LOCATION + column;
+				glEnableVertexAttribArray(location);
+				glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(instance), (void*)(base + offsetof(instance, modelMatrix) + column * sizeof(glm::vec4)));
+				glVertexAttribDivisor(location, 1);
+			}
+			glEnableVertexAttribArray(FRAME_INDEX_LOCATION);
+			glVertexAttribIPointer(FRAME_INDEX_LOCATION, 1, GL_INT, sizeof(instance), (void*)(base + offsetof(instance, frameIndex)));
+			glVertexAttribDivisor(FRAME_INDEX_LOCATION, 1);
+			glEnableVertexAttribArray(MATERIAL_LOCATION);
+			glVertexAttribIPointer(MATERIAL_LOCATION, 2, GL_INT, sizeof(instance), (void*)(base + offsetof(instance, material)));
+			glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+		}
+
+		void free()
+		{
+			if (buffer) glDeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+
+	private:
+
+		GLuint buffer = 0;
+		std::vector<instance> instances;
+
+};
@@ -235,22 +235,4 @@ void Level::load(std::string levelPath)
 		}
 	}
 	std::cout << "loaded " << models.size() << " models.";
-	// if no point lights,
-	if (pointLights.size() == 0) {
-		// add one unlit point light if none exists, so that the lighting shader compiles, as it expects at least one point light
-		PointLight pointLight(glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f);
-		pointLights.push_back(pointLight);
-	}
-	// edit the lighting shader to reflect the number of point lights
-	Utility::replaceLineInFile("shaders/lighting.glfs", 7, "#define NR_POINT_LIGHTS " + std::to_string(pointLights.size()));
-
-	// if no spot lights,
-	if (spotLights.size() == 0) {
-		// add one unlit spot light if none exists, so that the lighting shader compiles, as it expects at least one spot light
-		SpotLight spotLight(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-		spotLights.push_back(spotLight);
-	}
-	// edit the lighting shader to reflect the number of spot lights
-	Utility::replaceLineInFile("shaders/lighting.glfs", 10, "#define NR_SPOT_LIGHTS " + std::to_string(spotLights.size()));
-
 }
\ No newline at end of file
@@ -8,7 +8,6 @@
 #include <memory>
 #include "Constructs3D.h"
 #include "Light.h"
-#include "Utility.h"
 
 class Level
 {
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Light.h"
+#include "GLStateCache.h"
+
+//point and spot lights packed into two buffer textures of RGBA32F texels, read by the lighting shader with texelFetch
+//the shader gets the light counts as uniforms, so any number of lights can be uploaded without editing or relinking it
+//point light: [position, cutoffDistance] [color, diffuseIntensity] [specularIntensity, constant, linear, quadratic]
+//spot light:  the same 3 texels, then [direction, cos(cutoff)] [cos(outerCutoff), cutoff, 0, 0]
+class LightBuffer
+{
+	public:
+
+		static const int POINT_LIGHT_TEXELS = 3;
+		static const int SPOT_LIGHT_TEXELS = 5;
+
+		//packs and uploads the lights, creating the buffers on first use, needs the OpenGL context
+		void upload(GLStateCache& gl, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+		{
+			data.clear();
+			for (const PointLight& pl : pointLights) packPointLight(pl);
+			uploadTexels(gl, pointLightsBuffer, pointLightsTexture);
+
+			data.clear();
+			for (const SpotLight& sl : spotLights)
+			{
+				packPointLight(sl);
+				pushTexel(sl.direction, glm::cos(glm::radians(sl.cutoff)));
+				pushTexel(glm::vec3(glm::cos(glm::radians(sl.outerCutoff)), sl.cutoff, 0.0f), 0.0f);
+			}
+			uploadTexels(gl, spotLightsBuffer, spotLightsTexture);
+
+			pointLightsCnt = pointLights.size();
+			spotLightsCnt = spotLights.size();
+		}
+
+		//binds the buffer textures to the texture units of the given indices
+		void bind(GLStateCache& gl, GLuint pointLightsUnit, GLuint spotLightsUnit) const
+		{
+			bindPointLights(gl, pointLightsUnit);
+			bindSpotLights(gl, spotLightsUnit);
+		}
+
+		void bindPointLights(GLStateCache& gl, GLuint unit) const
+		{
+			gl.bindTexture(unit, GL_TEXTURE_BUFFER, pointLightsTexture);
+		}
+
+		void bindSpotLights(GLStateCache& gl, GLuint unit) const
+		{
+			gl.bindTexture(unit, GL_TEXTURE_BUFFER, spotLightsTexture);
+		}
+
+		int getPointLightsCnt() const
+		{
+			return pointLightsCnt;
+		}
+
+		int getSpotLightsCnt() const
+		{
+			return spotLightsCnt;
+		}
+
+		void free()
+		{
+			if (pointLightsTexture) glDeleteTextures(1, &pointLightsTexture);
+			if (spotLightsTexture) glDeleteTextures(1, &spotLightsTexture);
+			if (pointLightsBuffer) glDeleteBuffers(1, &pointLightsBuffer);
+			if (spotLightsBuffer) glDeleteBuffers(1, &spotLightsBuffer);
+			pointLightsTexture = spotLightsTexture = pointLightsBuffer = spotLightsBuffer = 0;
+		}
+
+	private:
+
+		GLuint pointLightsBuffer = 0;
+		GLuint pointLightsTexture = 0;
+		GLuint spotLightsBuffer = 0;
+		GLuint spotLightsTexture = 0;
+		int pointLightsCnt = 0;
+		int spotLightsCnt = 0;
+		std::vector<GLfloat> data;
+
+		void pushTexel(glm::vec3 xyz, float w)
+		{
+			data.push_back(xyz.x);
+			data.push_back(xyz.y);
+			data.push_back(xyz.z);
+			data.push_back(w);
+		}
+
+		void packPointLight(const PointLight& pl)
+		{
+			pushTexel(pl.position, pl.cutoffDistance);
+			pushTexel(pl.color, pl.diffuseIntensity);
+			pushTexel(glm::vec3(pl.specularIntensity, pl.constant, pl.linear), pl.quadratic);
+		}
+
+		//replaces the store of the buffer with the packed texels, at least one so that the buffer texture is never empty
+		void uploadTexels(GLStateCache& gl, GLuint& buffer, GLuint& texture)
+		{
+			if (data.empty()) pushTexel(glm::vec3(0.0f), 0.0f);
+			if (buffer == 0)
+			{
+				glGenBuffers(1, &buffer);
+				glGenTextures(1, &texture);
+			}
+			glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+			glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_DYNAMIC_DRAW);
+			gl.bindTexture(0, GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+
+};
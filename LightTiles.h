@@ -0,0 +1,173 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Light.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+
+//screen split into square tiles, each listing the point and spot lights whose cutoff sphere covers part of it
+//the lights are binned on the CPU every frame from the screen rectangles of their spheres, the lighting shader then
+//loops only over the lights of the tile of its pixel, so its cost follows the local light density and not the total light count
+//the lists are uploaded to two integer buffer textures:
+//tiles:   one RGBA32I texel per tile, [first index, point lights count, spot lights count, 0], row by row from the bottom left
+//indices: R32I light indices, for every tile its point lights then its spot lights, starting at the first index
+class LightTileGrid
+{
+	public:
+
+		LightTileGrid(unsigned int screenWidth = 800, unsigned int screenHeight = 600, unsigned int tileSize = 16)
+		: screenWidth(screenWidth), screenHeight(screenHeight), tileSize(std::max(1u, tileSize)),
+		  tilesX((screenWidth + std::max(1u, tileSize) - 1) / std::max(1u, tileSize)),
+		  tilesY((screenHeight + std::max(1u, tileSize) - 1) / std::max(1u, tileSize)),
+		  tiles(tilesX * tilesY * 4, 0) {}
+
+		//bins the lights in view of the view-projection matrix into the tiles their cutoff spheres overlap
+		void bin(const glm::mat4& viewProjectionMatrix, const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+		{
+			frustum f(viewProjectionMatrix);
+			pointRects.clear();
+			spotRects.clear();
+			for (const PointLight& pl : pointLights) pointRects.push_back(tileRect(viewProjectionMatrix, f, pl.position, pl.cutoffDistance));
+			for (const SpotLight& sl : spotLights) spotRects.push_back(tileRect(viewProjectionMatrix, f, sl.position, sl.cutoffDistance));
+
+			//count the lights of every tile, then turn the counts into the first index of every tile
+			std::fill(tiles.begin(), tiles.end(), 0);
+			for (const rect& r : pointRects) forEachTile(r, [&](int t) { tiles[t * 4 + 1]++; });
+			for (const rect& r : spotRects) forEachTile(r, [&](int t) { tiles[t * 4 + 2]++; });
+			GLint first = 0;
+			for (unsigned int t = 0; t < tilesX * tilesY; t++)
+			{
+				tiles[t * 4] = first;
+				first += tiles[t * 4 + 1] + tiles[t * 4 + 2];
+			}
+
+			//fill the lists, the point lights of a tile come first, its spot lights right after them
+			indices.assign(std::max(1, first), 0);
+			fill.assign(tilesX * tilesY, 0);
+			for (size_t i = 0; i < pointRects.size(); i++)
+			{
+				forEachTile(pointRects[i], [&](int t) { indices[tiles[t * 4] + fill[t]++] = i; });
+			}
+			for (size_t i = 0; i < spotRects.size(); i++)
+			{
+				forEachTile(spotRects[i], [&](int t) { indices[tiles[t * 4] + tiles[t * 4 + 1] + fill[t]++] = i; });
+			}
+			lightRefsCnt = first;
+		}
+
+		//uploads the binned lists, creating the buffers on first use, needs the OpenGL context
+		void upload(GLStateCache& gl)
+		{
+			uploadTexels(gl, tilesBuffer, tilesTexture, GL_RGBA32I, tiles);
+			uploadTexels(gl, indicesBuffer, indicesTexture, GL_R32I, indices);
+		}
+
+		//binds the buffer textures to the texture units of the given indices
+		void bind(GLStateCache& gl, GLuint tilesUnit, GLuint indicesUnit) const
+		{
+			gl.bindTexture(tilesUnit, GL_TEXTURE_BUFFER, tilesTexture);
+			gl.bindTexture(indicesUnit, GL_TEXTURE_BUFFER, indicesTexture);
+		}
+
+		unsigned int getTileSize() const
+		{
+			return tileSize;
+		}
+
+		unsigned int getTilesX() const
+		{
+			return tilesX;
+		}
+
+		//light entries over all the tiles of the last binning, the work of the lighting shader grows with it
+		unsigned long getLightRefsCnt() const
+		{
+			return lightRefsCnt;
+		}
+
+		void free()
+		{
+			if (tilesTexture) glDeleteTextures(1, &tilesTexture);
+			if (indicesTexture) glDeleteTextures(1, &indicesTexture);
+			if (tilesBuffer) glDeleteBuffers(1, &tilesBuffer);
+			if (indicesBuffer) glDeleteBuffers(1, &indicesBuffer);
+			tilesTexture = indicesTexture = tilesBuffer = indicesBuffer = 0;
+		}
+
+	private:
+
+		//inclusive range of tiles, empty if minX > maxX
+		typedef struct rect
+		{
+			int minX, maxX, minY, maxY;
+		} rect;
+
+		unsigned int screenWidth;
+		unsigned int screenHeight;
+		unsigned int tileSize;
+		unsigned int tilesX;
+		unsigned int tilesY;
+		std::vector<GLint> tiles;
+		std::vector<GLint> indices;
+		std::vector<GLint> fill;
+		std::vector<rect> pointRects;
+		std::vector<rect> spotRects;
+		unsigned long lightRefsCnt = 0;
+		GLuint tilesBuffer = 0;
+		GLuint tilesTexture = 0;
+		GLuint indicesBuffer = 0;
+		GLuint indicesTexture = 0;
+
+		//tiles covered by the screen rectangle of the box around a sphere, all of them if the box reaches behind the camera
+		rect tileRect(const glm::mat4& viewProjectionMatrix, const frustum& f, const glm::vec3& center, float radius) const
+		{
+			boundingbox b = { center.x - radius, center.x + radius, center.y - radius, center.y + radius, center.z - radius, center.z + radius };
+			if (!f.intersects(b)) return { 0, -1, 0, -1 };
+
+			float minSX = FLT_MAX, maxSX = -FLT_MAX, minSY = FLT_MAX, maxSY = -FLT_MAX;
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec4 clip = viewProjectionMatrix * glm::vec4(i & 1 ? b.maxX : b.minX, i & 2 ? b.maxY : b.minY, i & 4 ? b.maxZ : b.minZ, 1.0f);
+				if (clip.w <= 1e-6f) return { 0, (int)tilesX - 1, 0, (int)tilesY - 1 };
+				minSX = std::min(minSX, clip.x / clip.w); maxSX = std::max(maxSX, clip.x / clip.w);
+				minSY = std::min(minSY, clip.y / clip.w); maxSY = std::max(maxSY, clip.y / clip.w);
+			}
+			rect r;
+			r.minX = std::max(0, (int)std::floor((minSX * 0.5f + 0.5f) * screenWidth / tileSize));
+			r.maxX = std::min((int)tilesX - 1, (int)std::floor((maxSX * 0.5f + 0.5f) * screenWidth / tileSize));
+			r.minY = std::max(0, (int)std::floor((minSY * 0.5f + 0.5f) * screenHeight / tileSize));
+			r.maxY = std::min((int)tilesY - 1, (int)std::floor((maxSY * 0.5f + 0.5f) * screenHeight / tileSize));
+			if (r.minX > r.maxX || r.minY > r.maxY) return { 0, -1, 0, -1 };
+			return r;
+		}
+
+		template <typename F> void forEachTile(const rect& r, F f) const
+		{
+			for (int y = r.minY; y <= r.maxY; y++)
+			{
+				for (int x = r.minX; x <= r.maxX; x++) f(y * tilesX + x);
+			}
+		}
+
+		void uploadTexels(GLStateCache& gl, GLuint& buffer, GLuint& texture, GLenum format, const std::vector<GLint>& data)
+		{
+			if (buffer == 0)
+			{
+				glGenBuffers(1, &buffer);
+				glGenTextures(1, &texture);
+			}
+			glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+			glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(GLint), data.data(), GL_STREAM_DRAW);
+			gl.bindTexture(0, GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+
+};
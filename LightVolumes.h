@@ -0,0 +1,136 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include "GLStateCache.h"
+#include <vector>
+#include <cmath>
+
+//unit meshes the point and spot lights are drawn with in the VOLUMES lighting mode, scaled and placed per light by the vertex shader
+//sphere: radius 1 around the origin, cone: apex at the origin, opening along +z with a base of radius 1 at z = 1
+//both are built slightly larger than the shapes they stand for, so that their flat faces never cut into the lit volume
+class LightVolumeMeshes
+{
+	public:
+
+		static const int SPHERE_RINGS = 8;
+		static const int SPHERE_SEGMENTS = 12;
+		static const int CONE_SEGMENTS = 16;
+
+		//builds the meshes, needs the OpenGL context
+		void init()
+		{
+			std::vector<GLfloat> vertices;
+			std::vector<GLuint> indices;
+
+			//sphere, rings of vertices from pole to pole
+			float sphereScale = 1.0f / (std::cos((float)M_PI / SPHERE_SEGMENTS) * std::cos((float)M_PI / (2 * SPHERE_RINGS)));
+			for (int r = 0; r <= SPHERE_RINGS; r++)
+			{
+				float theta = (float)M_PI * r / SPHERE_RINGS;
+				for (int s = 0; s < SPHERE_SEGMENTS; s++)
+				{
+					float phi = 2.0f * (float)M_PI * s / SPHERE_SEGMENTS;
+					pushVertex(vertices, std::sin(theta) * std::cos(phi) * sphereScale, std::cos(theta) * sphereScale, std::sin(theta) * std::sin(phi) * sphereScale);
+				}
+			}
+			for (int r = 0; r < SPHERE_RINGS; r++)
+			{
+				for (int s = 0; s < SPHERE_SEGMENTS; s++)
+				{
+					GLuint a = r * SPHERE_SEGMENTS + s, b = r * SPHERE_SEGMENTS + (s + 1) % SPHERE_SEGMENTS;
+					GLuint c = a + SPHERE_SEGMENTS, d = b + SPHERE_SEGMENTS;
+					pushTriangle(indices, a, b, c);
+					pushTriangle(indices, b, d, c);
+				}
+			}
+			sphereIndexCount = indices.size();
+
+			//cone, apex, base ring and base center
+			GLuint apex = vertices.size() / 3;
+			float coneScale = 1.0f / std::cos((float)M_PI / CONE_SEGMENTS);
+			pushVertex(vertices, 0.0f, 0.0f, 0.0f);
+			for (int s = 0; s < CONE_SEGMENTS; s++)
+			{
+				float phi = 2.0f * (float)M_PI * s / CONE_SEGMENTS;
+				pushVertex(vertices, std::cos(phi) * coneScale, std::sin(phi) * coneScale, 1.0f);
+			}
+			GLuint center = vertices.size() / 3;
+			pushVertex(vertices, 0.0f, 0.0f, 1.0f);
+			for (int s = 0; s < CONE_SEGMENTS; s++)
+			{
+				GLuint a = apex + 1 + s, b = apex + 1 + (s + 1) % CONE_SEGMENTS;
+				pushTriangle(indices, apex, b, a);
+				pushTriangle(indices, center, a, b);
+			}
+			coneFirstIndex = sphereIndexCount;
+			coneIndexCount = indices.size() - sphereIndexCount;
+
+			glGenVertexArrays(1, &vao);
+			glGenBuffers(1, &vbo);
+			glGenBuffers(1, &ibo);
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+
+		//draws one sphere per light, the vertex shader places the instance after the light of the same index
+		void drawSpheres(GLStateCache& gl, GLsizei instances) const
+		{
+			draw(gl, 0, sphereIndexCount, instances);
+		}
+
+		//draws one cone per light, the vertex shader places the instance after the light of the same index
+		void drawCones(GLStateCache& gl, GLsizei instances) const
+		{
+			draw(gl, coneFirstIndex, coneIndexCount, instances);
+		}
+
+		void free()
+		{
+			if (vao) glDeleteVertexArrays(1, &vao);
+			if (vbo) glDeleteBuffers(1, &vbo);
+			if (ibo) glDeleteBuffers(1, &ibo);
+			vao = vbo = ibo = 0;
+		}
+
+	private:
+
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		GLuint ibo = 0;
+		GLsizei sphereIndexCount = 0;
+		GLsizei coneFirstIndex = 0;
+		GLsizei coneIndexCount = 0;
+
+		void pushVertex(std::vector<GLfloat>& vertices, float x, float y, float z)
+		{
+			vertices.push_back(x);
+			vertices.push_back(y);
+			vertices.push_back(z);
+		}
+
+		//counter-clockwise seen from outside
+		void pushTriangle(std::vector<GLuint>& indices, GLuint a, GLuint b, GLuint c)
+		{
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(c);
+		}
+
+		void draw(GLStateCache& gl, GLsizei firstIndex, GLsizei indexCount, GLsizei instances) const
+		{
+			if (instances <= 0 || vao == 0) return;
+			gl.bindVertexArray(vao);
+			glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(GLuint)), instances);
+		}
+
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include "Constructs3D.h"
+#include "Frustum.h"
+
+//per-frame culling and collision state of the registered models, kept in contiguous arrays indexed by a stable handle
+//the model keeps the cold data (mesh, texture, animation frames) and its handle, handles of removed models are reused
+class ModelStore
+{
+	public:
+
+		//world-space bounding boxes, mirrored from the model when its cache is refreshed, frustum-tested in batches
+		aabbBatch worldBoxes;
+
+		//screen-space bounding boxes: x and y in [0, 1], z in clip space
+		std::vector<boundingbox> screenBoxes;
+
+		std::vector<float> distance; //distance from the person to the nearest vertex
+		std::vector<unsigned char> isInDOF;
+		std::vector<unsigned char> isInFOV;
+		std::vector<unsigned char> inFocus;
+		std::vector<unsigned char> isCovered;
+		std::vector<unsigned char> isSkyBox;
+		std::vector<unsigned long> updatedCellEpoch; //cell epoch of the scheduler in which the model was last updated
+		std::vector<unsigned long> lastInRangeTick;
+		std::vector<unsigned long> lastNearPersonTick;
+		std::vector<int> proxy; //BVH leaf id, -1 if not in the BVH
+
+		//model owning each handle, nullptr if the handle is free
+		std::vector<model*> models;
+
+		//takes a free handle, or grows the arrays, and resets its state
+		int add(model* m)
+		{
+			int handle;
+			if (!freeHandles.empty())
+			{
+				handle = freeHandles.back();
+				freeHandles.pop_back();
+			} else
+			{
+				handle = models.size();
+				resize(handle + 1);
+			}
+			models[handle] = m;
+			worldBoxes.set(handle, m->worldBBox);
+			screenBoxes[handle] = boundingbox();
+			distance[handle] = 0.0f;
+			isInDOF[handle] = 1;
+			isInFOV[handle] = 1;
+			inFocus[handle] = 0;
+			isCovered[handle] = 0;
+			isSkyBox[handle] = 0;
+			updatedCellEpoch[handle] = 0;
+			lastInRangeTick[handle] = 0;
+			lastNearPersonTick[handle] = 0;
+			proxy[handle] = -1;
+			return handle;
+		}
+
+		void remove(int handle)
+		{
+			if (!isValid(handle)) return;
+			models[handle] = nullptr;
+			proxy[handle] = -1;
+			freeHandles.push_back(handle);
+		}
+
+		bool isValid(int handle) const
+		{
+			return handle >= 0 && (size_t)handle < models.size() && models[handle] != nullptr;
+		}
+
+		//copies the world-space bounding box of the model after its cache was refreshed
+		void refit(int handle)
+		{
+			worldBoxes.set(handle, models[handle]->worldBBox);
+		}
+
+		void clear()
+		{
+			resize(0);
+			freeHandles.clear();
+		}
+
+		//number of handles, including the free ones
+		size_t capacity() const
+		{
+			return models.size();
+		}
+
+	private:
+
+		std::vector<int> freeHandles;
+
+		void resize(size_t count)
+		{
+			worldBoxes.resize(count);
+			screenBoxes.resize(count);
+			distance.resize(count);
+			isInDOF.resize(count);
+			isInFOV.resize(count);
+			inFocus.resize(count);
+			isCovered.resize(count);
+			isSkyBox.resize(count);
+			updatedCellEpoch.resize(count);
+			lastInRangeTick.resize(count);
+			lastNearPersonTick.resize(count);
+			proxy.resize(count);
+			models.resize(count);
+		}
+
+};
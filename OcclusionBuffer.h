@@ -0,0 +1,209 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include "Constructs3D.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OCCLUSION_USE_SSE
+#endif
+
+//low-resolution depth buffer for software occlusion culling: the largest opaque models are rasterized into it,
+//then the screen rectangles of the bounding boxes of the other models are tested against it
+//every pixel keeps the nearest view depth (clip w) of the occluders covering its center, each triangle is written at its farthest depth,
+//so a model is only reported hidden if every pixel of its rectangle is covered by an occluder nearer than the nearest corner of its box
+class OcclusionBuffer
+{
+	public:
+
+		OcclusionBuffer(unsigned int width = 256, unsigned int height = 128, unsigned int bandsCnt = 1)
+		: width(std::max(4u, width)), height(std::max(1u, height)), stride((std::max(4u, width) + 3) & ~3u),
+		  bandsCnt(std::clamp(bandsCnt, 1u, std::max(1u, height))), depth(stride * std::max(1u, height), FLT_MAX) {}
+
+		//empties the buffer and the occluders for a new view-projection matrix
+		void clear(const glm::mat4& viewProjectionMatrix)
+		{
+			this->viewProjectionMatrix = viewProjectionMatrix;
+			triangles.clear();
+			std::fill(depth.begin(), depth.end(), FLT_MAX);
+		}
+
+		//transforms the world-space triangles of an occluder to screen space, clipping them at the near plane
+		void addOccluder(const triangleStream& tris)
+		{
+			const glm::mat4& m = viewProjectionMatrix;
+			for (size_t t = 0; t < tris.size(); t++)
+			{
+				glm::vec4 clip[3];
+				for (int v = 0; v < 3; v++) clip[v] = m * tris.get(t, v);
+
+				//keep the part in front of the near plane (z >= -w), a polygon of up to 4 vertices
+				glm::vec4 polygon[4];
+				int verticesCnt = 0;
+				for (int v = 0; v < 3; v++)
+				{
+					const glm::vec4& a = clip[v];
+					const glm::vec4& b = clip[(v + 1) % 3];
+					float da = a.z + a.w, db = b.z + b.w;
+					if (da >= 0.0f) polygon[verticesCnt++] = a;
+					if ((da >= 0.0f) != (db >= 0.0f)) polygon[verticesCnt++] = a + (b - a) * (da / (da - db));
+				}
+				for (int v = 1; v + 1 < verticesCnt; v++) addTriangle(polygon[0], polygon[v], polygon[v + 1]);
+			}
+		}
+
+		//rasterizes the occluders into the rows of one band, the bands can be rasterized concurrently
+		void rasterizeBand(unsigned int band)
+		{
+			int bandMinY = band * height / bandsCnt;
+			int bandMaxY = (band + 1) * height / bandsCnt - 1;
+			for (const screenTriangle& tri : triangles)
+			{
+				int minY = std::max(tri.minY, bandMinY);
+				int maxY = std::min(tri.maxY, bandMaxY);
+				for (int y = minY; y <= maxY; y++)
+				{
+					float py = y + 0.5f;
+					float row0 = tri.b[0] * py + tri.c[0];
+					float row1 = tri.b[1] * py + tri.c[1];
+					float row2 = tri.b[2] * py + tri.c[2];
+					float* row = &depth[y * stride];
+					int x = tri.minX & ~3;
+#ifdef OCCLUSION_USE_SSE
+					const __m128 zero = _mm_setzero_ps();
+					const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+					const __m128 a0 = _mm_set1_ps(tri.a[0]), a1 = _mm_set1_ps(tri.a[1]), a2 = _mm_set1_ps(tri.a[2]);
+					const __m128 r0 = _mm_set1_ps(row0), r1 = _mm_set1_ps(row1), r2 = _mm_set1_ps(row2);
+					const __m128 w = _mm_set1_ps(tri.maxW);
+					for (; x <= tri.maxX; x += 4)
+					{
+						__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+						__m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), zero),
+										_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), zero),
+												   _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), zero)));
+						__m128 d = _mm_loadu_ps(row + x);
+						_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(d, w)), _mm_andnot_ps(inside, d)));
+					}
+#endif
+					for (; x <= tri.maxX; x++)
+					{
+						float px = x + 0.5f;
+						if (tri.a[0] * px + row0 >= 0.0f && tri.a[1] * px + row1 >= 0.0f && tri.a[2] * px + row2 >= 0.0f)
+						{
+							row[x] = std::min(row[x], tri.maxW);
+						}
+					}
+				}
+			}
+		}
+
+		//false if the box is hidden behind the rasterized occluders, true if it may be visible
+		bool isVisible(const boundingbox& b) const
+		{
+			float minSX = FLT_MAX, maxSX = -FLT_MAX, minSY = FLT_MAX, maxSY = -FLT_MAX, minW = FLT_MAX;
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec4 clip = viewProjectionMatrix * glm::vec4(i & 1 ? b.maxX : b.minX, i & 2 ? b.maxY : b.minY, i & 4 ? b.maxZ : b.minZ, 1.0f);
+				//the box crosses the near plane, so it surrounds the camera or is right in front of it
+				if (clip.z < -clip.w) return true;
+				float sx = (clip.x / clip.w * 0.5f + 0.5f) * width;
+				float sy = (clip.y / clip.w * 0.5f + 0.5f) * height;
+				minSX = std::min(minSX, sx); maxSX = std::max(maxSX, sx);
+				minSY = std::min(minSY, sy); maxSY = std::max(maxSY, sy);
+				minW = std::min(minW, clip.w);
+			}
+			int minX = std::max(0, (int)std::floor(minSX));
+			int maxX = std::min((int)width - 1, (int)std::floor(maxSX));
+			int minY = std::max(0, (int)std::floor(minSY));
+			int maxY = std::min((int)height - 1, (int)std::floor(maxSY));
+			if (minX > maxX || minY > maxY) return true;
+
+			for (int y = minY; y <= maxY; y++)
+			{
+				const float* row = &depth[y * stride];
+				int x = minX;
+#ifdef OCCLUSION_USE_SSE
+				//whole groups of 4 pixels within the rectangle, the pixels left over are tested one by one
+				const __m128 w = _mm_set1_ps(minW);
+				for (; x + 3 <= maxX; x += 4)
+				{
+					if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), w))) return true;
+				}
+#endif
+				for (; x <= maxX; x++)
+				{
+					if (row[x] >= minW) return true;
+				}
+			}
+			return false;
+		}
+
+		unsigned int getBandsCnt() const
+		{
+			return bandsCnt;
+		}
+
+		size_t getTrianglesCnt() const
+		{
+			return triangles.size();
+		}
+
+	private:
+
+		//triangle in pixel coordinates, as edge functions a * x + b * y + c that are non-negative inside
+		typedef struct screenTriangle
+		{
+			float a[3], b[3], c[3];
+			float maxW; //farthest view depth of the triangle
+			int minX, maxX, minY, maxY; //pixel bounds, clamped to the buffer
+		} screenTriangle;
+
+		unsigned int width;
+		unsigned int height;
+		unsigned int stride; //row length, padded to whole groups of 4 pixels
+		unsigned int bandsCnt;
+		std::vector<float> depth;
+		std::vector<screenTriangle> triangles;
+		glm::mat4 viewProjectionMatrix = glm::mat4(1.0f);
+
+		void addTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+		{
+			const glm::vec4* clip[3] = { &c0, &c1, &c2 };
+			float sx[3], sy[3];
+			screenTriangle tri;
+			tri.maxW = 0.0f;
+			for (int v = 0; v < 3; v++)
+			{
+				float w = std::max(clip[v]->w, 1e-6f);
+				sx[v] = (clip[v]->x / w * 0.5f + 0.5f) * width;
+				sy[v] = (clip[v]->y / w * 0.5f + 0.5f) * height;
+				tri.maxW = std::max(tri.maxW, w);
+			}
+			tri.minX = std::max(0, (int)std::floor(std::min({ sx[0], sx[1], sx[2] })));
+			tri.maxX = std::min((int)width - 1, (int)std::floor(std::max({ sx[0], sx[1], sx[2] })));
+			tri.minY = std::max(0, (int)std::floor(std::min({ sy[0], sy[1], sy[2] })));
+			tri.maxY = std::min((int)height - 1, (int)std::floor(std::max({ sy[0], sy[1], sy[2] })));
+			if (tri.minX > tri.maxX || tri.minY > tri.maxY) return;
+
+			for (int e = 0; e < 3; e++)
+			{
+				int n = (e + 1) % 3;
+				tri.a[e] = sy[e] - sy[n];
+				tri.b[e] = sx[n] - sx[e];
+				tri.c[e] = sx[e] * sy[n] - sy[e] * sx[n];
+			}
+			//orient the edge functions to be positive inside, whatever the winding
+			float area = tri.a[0] * sx[2] + tri.b[0] * sy[2] + tri.c[0];
+			if (std::abs(area) < 1e-6f) return;
+			if (area < 0.0f)
+			{
+				for (int e = 0; e < 3; e++) { tri.a[e] = -tri.a[e]; tri.b[e] = -tri.b[e]; tri.c[e] = -tri.c[e]; }
+			}
+			triangles.push_back(tri);
+		}
+
+};
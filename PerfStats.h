@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//named counters accumulated over the ticks of one thread and printed as per-tick averages about once per second
+class PerfStats
+{
+	public:
+
+		PerfStats(std::string name = "") : name(name), lastReport(std::chrono::steady_clock::now()) {}
+
+		void add(const char* counter, unsigned long value = 1)
+		{
+			for (auto &c : counters)
+			{
+				if (std::strcmp(c.name, counter) == 0)
+				{
+					c.value += value;
+					return;
+				}
+			}
+			counters.push_back({ counter, value });
+		}
+
+		//counts a tick, prints and resets the counters if a second has passed since the last report
+		void tick()
+		{
+			ticks++;
+			auto now = std::chrono::steady_clock::now();
+			std::chrono::duration<float> elapsed = now - lastReport;
+			if (elapsed.count() < 1.0f) return;
+			std::cout << name << ": " << (unsigned long)(ticks / elapsed.count()) << " ticks/s";
+			for (auto &c : counters)
+			{
+				std::cout << ", " << c.name << " " << (float)c.value / ticks;
+				c.value = 0;
+			}
+			std::cout << std::endl;
+			ticks = 0;
+			lastReport = now;
+		}
+
+	private:
+
+		typedef struct counter {
+			const char* name;
+			unsigned long value;
+		} counter;
+
+		std::string name;
+		std::vector<counter> counters;
+		unsigned long ticks = 0;
+		std::chrono::steady_clock::time_point lastReport;
+};
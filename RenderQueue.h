@@ -0,0 +1,102 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "SceneSnapshot.h"
+
+//draws of one frame ordered by 64-bit keys, so that the draws sharing state end up next to each other
+//cubes and opaque passes: [pass:2][culling off:1][texture:20][mesh:32][unused:9]
+//transparent pass:        [pass:2][inverted distance:32][culling off:1][texture:20][unused:9], back to front first
+class RenderQueue
+{
+	public:
+
+		typedef enum renderPass
+		{
+			CUBE_PASS = 0,
+			OPAQUE_PASS = 1,
+			TRANSPARENT_PASS = 2
+		} renderPass;
+
+		typedef struct queuedDraw
+		{
+			uint64_t key;
+			GLuint textureId; //cubemap, or set of texture arrays, standing for the textures of the draw
+			const drawItem* item;
+		} queuedDraw;
+
+		//state switches between consecutive draws
+		typedef struct stateChanges
+		{
+			unsigned long passes = 0;
+			unsigned long textures = 0;
+			unsigned long cullModes = 0;
+		} stateChanges;
+
+		void clear()
+		{
+			draws.clear();
+		}
+
+		void push(renderPass p, const drawItem& item, GLuint textureId)
+		{
+			uint64_t cullOff = item.shape == shapetype::RECTANGLE ? 1 : 0;
+			uint64_t texture = textureId & 0xFFFFF;
+			uint64_t key = (uint64_t)p << 62;
+			if (p == TRANSPARENT_PASS)
+			{
+				//distances are never negative, so their bits order like the distances themselves
+				uint32_t distanceBits;
+				std::memcpy(&distanceBits, &item.distance, sizeof(distanceBits));
+				key |= (uint64_t)(~distanceBits) << 30 | cullOff << 29 | texture << 9;
+			}
+			else
+			{
+				key |= cullOff << 61 | texture << 41 | (uint64_t)item.meshKey << 9;
+			}
+			draws.push_back({ key, textureId, &item });
+		}
+
+		void sort()
+		{
+			std::sort(draws.begin(), draws.end(), [](const queuedDraw& a, const queuedDraw& b) { return a.key < b.key; });
+		}
+
+		const std::vector<queuedDraw>& getDraws() const
+		{
+			return draws;
+		}
+
+		//first and one past the last draw of a pass, once sorted
+		std::pair<size_t, size_t> passRange(renderPass p) const
+		{
+			auto first = std::lower_bound(draws.begin(), draws.end(), (uint64_t)p << 62, [](const queuedDraw& d, uint64_t key) { return d.key < key; });
+			auto last = std::lower_bound(first, draws.end(), (uint64_t)(p + 1) << 62, [](const queuedDraw& d, uint64_t key) { return d.key < key; });
+			return { (size_t)(first - draws.begin()), (size_t)(last - draws.begin()) };
+		}
+
+		//counts the state switches between the draws in their current order, before and after sorting
+		stateChanges countChanges() const
+		{
+			stateChanges changes;
+			for (size_t i = 1; i < draws.size(); i++)
+			{
+				const queuedDraw& a = draws[i - 1];
+				const queuedDraw& b = draws[i];
+				if (a.key >> 62 != b.key >> 62) changes.passes++;
+				if (a.textureId != b.textureId) changes.textures++;
+				if ((a.item->shape == shapetype::RECTANGLE) != (b.item->shape == shapetype::RECTANGLE)) changes.cullModes++;
+			}
+			return changes;
+		}
+
+	private:
+
+		std::vector<queuedDraw> draws;
+
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ArtificeShaderProgram.h"
+#include "InstanceBuffer.h"
+#include "IndirectDrawBuffer.h"
+#include "GLStateCache.h"
+#include "Constructs3D.h"
+#include "Light.h"
+
+//handles of the uniforms drawItem::render sets, resolved once per geometry shader after it is loaded
+//the samplers are not among them, their units are fixed and set once when the shader is loaded
+typedef struct geometryUniforms
+{
+	int frameRows = -1, frameCols = -1;
+	int existsLightmap = -1, existsNormalmap = -1, existsDisplacementmap = -1;
+
+	void resolve(const ShaderProgram& shader)
+	{
+		frameRows = shader.getUniformHandle("frameRows");
+		frameCols = shader.getUniformHandle("frameCols");
+		existsLightmap = shader.getUniformHandle("material.existsLightmap");
+		existsNormalmap = shader.getUniformHandle("material.existsNormalmap");
+		existsDisplacementmap = shader.getUniformHandle("material.existsDisplacementmap");
+	}
+} geometryUniforms;
+
+
+//what the rendering thread needs to draw a model, copied from the model when the snapshot is published
+typedef struct drawItem
+{
+	unsigned long id = 0;
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+	unsigned long firstIndex = 0; //first index of the model in the index buffer of its shape
+	unsigned long baseVertex = 0; //first vertex of the model in the vertex buffer of its shape
+	unsigned long indexCount = 0;
+	unsigned short frameIndex = 0;
+	unsigned short frameRows = 1;
+	unsigned short frameCols = 1;
+	shapetype shape = shapetype::CUBE;
+	bool isSkyBox = false;
+	float distance = 0.0f; //distance from the person, to draw transparent models back to front
+	glm::vec3 extents = glm::vec3(0.0f); //size of the mesh, the shapes are built from their size alone so equal sizes mean equal meshes
+	uint32_t meshKey = 0; //hash of the mesh and frame grid, equal for the items that can be batched when their textures are equal too
+	const model* source = nullptr; //the model the item was copied from, only a key to find its ranges again, never read
+	unsigned long meshRevision = 0; //of the mesh whose ranges firstIndex and baseVertex were copied from
+	//the material, resolved from the name of the texture when the item is published so that drawing never looks names up:
+	//the set of cubemaps of a cube or the skybox, or the set of texture arrays of the other shapes, 0 for none
+	GLuint textureSet = 0;
+	GLint layer = 0; //of the material in the arrays of its set
+	GLint maps = 0; //a bit per map the material has
+	bool isTransparent = false;
+
+	drawItem() {}
+
+	drawItem(const model& m, float distance, bool isSkyBox = false)
+	: id(m.id), modelMatrix(m.modelMatrix), firstIndex(m.sn), baseVertex(m.baseVertex), indexCount(m.modelMesh.tris.size() * 3),
+	  frameIndex(m.frameIndex), frameRows(m.frameRows), frameCols(m.frameCols),
+	  shape(m.modelMesh.shape), isSkyBox(isSkyBox), distance(distance),
+	  extents(m.localBBox.maxX - m.localBBox.minX, m.localBBox.maxY - m.localBBox.minY, m.localBBox.maxZ - m.localBBox.minZ),
+	  source(&m), meshRevision(m.meshRevision)
+	{
+		//FNV-1a over the fields isBatchedWith compares, but the texture which the draw order keys hold apart
+		meshKey = 2166136261u;
+		auto mix = [this](const void* data, size_t size) {
+			for (size_t i = 0; i < size; i++) meshKey = (meshKey ^ ((const unsigned char*)data)[i]) * 16777619u;
+		};
+		mix(&shape, sizeof(shape));
+		mix(&indexCount, sizeof(indexCount));
+		mix(&extents[0], 3 * sizeof(float));
+		mix(&frameRows, sizeof(frameRows));
+		mix(&frameCols, sizeof(frameCols));
+	}
+
+	//true if the item can be drawn as another instance of this one: same mesh and same frame grid
+	//the textures are the caller's to compare, cubes need the same cubemap, the other shapes the same set of texture arrays
+	bool isBatchedWith(const drawItem& o) const
+	{
+		return shape == o.shape && indexCount == o.indexCount && extents == o.extents && frameRows == o.frameRows && frameCols == o.frameCols;
+	}
+
+	//draws the item once, binding its textures first, for the skybox
+	void render(GLStateCache& gl, ArtificeShaderProgram* geometryShader, const geometryUniforms& u, GLuint vao, GLuint ibo, GLuint textureId, GLuint lightmapId, GLuint normalmapId, GLuint displacementmapId) const
+	{
+		bindTextures(gl, geometryShader, u, textureId, lightmapId, normalmapId, displacementmapId);
+		draw(gl, geometryShader, u, vao, ibo, nullptr, 0, 1);
+	}
+
+	//binds the cubemaps of a cube or the skybox to the units 0 to 3, the other shapes bind the texture arrays of their materials
+	void bindTextures(GLStateCache& gl, ArtificeShaderProgram* geometryShader, const geometryUniforms& u, GLuint textureId, GLuint lightmapId, GLuint normalmapId, GLuint displacementmapId) const
+	{
+		gl.bindTexture(0, GL_TEXTURE_CUBE_MAP, textureId);
+
+		geometryShader->setBool(u.existsLightmap, lightmapId > 0);
+		gl.bindTexture(1, GL_TEXTURE_CUBE_MAP, lightmapId);
+
+		geometryShader->setBool(u.existsNormalmap, normalmapId > 0);
+		gl.bindTexture(2, GL_TEXTURE_CUBE_MAP, normalmapId);
+
+		geometryShader->setBool(u.existsDisplacementmap, displacementmapId > 0);
+		gl.bindTexture(3, GL_TEXTURE_CUBE_MAP, displacementmapId);
+	}
+
+	//draws the mesh of the item once per instance, the model matrices and frame indices come from the instances starting at firstInstance
+	//without instances (the skybox) the mesh is drawn once, with the attributes left as they are
+	void draw(GLStateCache& gl, ArtificeShaderProgram* geometryShader, const geometryUniforms& u, GLuint vao, GLuint ibo, const InstanceBuffer* instances, size_t firstInstance, GLsizei instanceCount) const
+	{
+		if (shape != shapetype::CUBE)
+		{
+			geometryShader->setInt(u.frameRows, frameRows);
+			geometryShader->setInt(u.frameCols, frameCols);
+		}
+		gl.bindVertexArray(vao);
+		gl.bindElementBuffer(ibo);
+		if (instances) instances->bindAttributes(gl, firstInstance);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(GLuint)), instanceCount, baseVertex);
+	}
+
+	//draws a run of commands with the frame grid of the item, each command finding its instances by its base instance
+	//the instance attributes are pointed at the first instance of the buffer, the base instances count from there
+	void drawIndirect(GLStateCache& gl, ArtificeShaderProgram* geometryShader, const geometryUniforms& u, GLuint vao, GLuint ibo, const InstanceBuffer& instances, const IndirectDrawBuffer& commands, size_t firstCommand, GLsizei commandCount) const
+	{
+		if (shape != shapetype::CUBE)
+		{
+			geometryShader->setInt(u.frameRows, frameRows);
+			geometryShader->setInt(u.frameCols, frameCols);
+		}
+		gl.bindVertexArray(vao);
+		gl.bindElementBuffer(ibo);
+		instances.bindAttributes(gl, 0);
+		commands.draw(gl, firstCommand, commandCount);
+	}
+
+} drawItem;
+
+
+//items drawn with one instanced draw, the mesh and textures of the first one and the model matrices of all of them
+typedef struct drawBatch
+{
+	const drawItem* prototype;
+	size_t firstInstance;
+	GLsizei instanceCount;
+} drawBatch;
+
+
+//the lights of the scene, shared by the snapshots until the editor changes them
+typedef struct lightSet
+{
+	Light light;
+	std::vector<PointLight> pointLights;
+	std::vector<SpotLight> spotLights;
+	SpotLight flashLight;
+	bool assignedFlashLight = false;
+} lightSet;
+
+
+typedef struct cameraState
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+} cameraState;
+
+
+//everything the rendering thread reads to draw one frame, published by the engine thread at the end of every tick
+typedef struct sceneSnapshot
+{
+	unsigned long tick = 0;
+	std::chrono::steady_clock::time_point time;
+
+	std::vector<drawItem> cubeItems;
+	std::vector<drawItem> items;
+	bool hasSkyBox = false;
+	drawItem skyBox;
+	//generations of the arenas the ranges of the items were copied in, the rendering thread finds the ranges again when they change
+	unsigned long cubeArenaGeneration = 0;
+	unsigned long modelArenaGeneration = 0;
+
+	glm::mat4 projectionMatrix = glm::mat4(1.0f);
+	cameraState prevCamera; //camera of the previous tick, interpolated towards the current one
+	cameraState camera;
+
+	glm::vec3 personPos = glm::vec3(0.0f);
+	glm::vec3 personFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	bool isFlashLightOn = false;
+	std::shared_ptr<const lightSet> lights;
+} sceneSnapshot;
+
+
+//lock-free triple buffer between one writer and one reader: the writer always has a slot to fill and the reader always has the latest complete one
+//neither side ever waits, the writer may overwrite a slot the reader has not taken yet, and the reader may take the same slot again
+template<typename T>
+class TripleBuffer
+{
+	public:
+
+		T& writeSlot()
+		{
+			return slots[writeIndex];
+		}
+
+		//hands the filled write slot over to the reader, returns true if it replaced a slot the reader never took
+		bool publish()
+		{
+			unsigned int prev = shared.exchange(writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+			writeIndex = prev & INDEX_MASK;
+			return (prev & FRESH_BIT) != 0;
+		}
+
+		//takes the latest published slot, returns false if nothing was published since the last call
+		bool consume()
+		{
+			if ((shared.load(std::memory_order_acquire) & FRESH_BIT) == 0) return false;
+			unsigned int prev = shared.exchange(readIndex, std::memory_order_acq_rel);
+			readIndex = prev & INDEX_MASK;
+			return true;
+		}
+
+		const T& readSlot() const
+		{
+			return slots[readIndex];
+		}
+
+		//the reader may update the slot it took, the writer never touches it until it is consumed again
+		T& readSlot()
+		{
+			return slots[readIndex];
+		}
+
+	private:
+
+		static const unsigned int INDEX_MASK = 3;
+		static const unsigned int FRESH_BIT = 4;
+
+		T slots[3];
+		unsigned int writeIndex = 0;
+		unsigned int readIndex = 1;
+		std::atomic<unsigned int> shared{ 2 }; //index of the slot in between, and whether it is fresh
+};
@@ -4,6 +4,7 @@ and may not be redestributed without written permission.*/
 
 #include "ShaderProgram.h"
 #include <fstream>
+#include <algorithm>
 
 ShaderProgram::ShaderProgram()
 {
@@ -23,6 +24,8 @@ void ShaderProgram::freeProgram()
 		glDeleteProgram( mProgramID );
 		mProgramID = NULL;
 	}
+	uniforms.clear();
+	uniformHandles.clear();
 }
 
 bool ShaderProgram::bind()
@@ -58,6 +61,47 @@ GLuint ShaderProgram::getProgramID()
 	return mProgramID;
 }
 
+int ShaderProgram::getUniformHandle(const std::string &name) const
+{
+	auto itr = uniformHandles.find(name);
+	return itr != uniformHandles.end() ? itr->second : -1;
+}
+
+void ShaderProgram::cacheUniforms()
+{
+	uniforms.clear();
+	uniformHandles.clear();
+
+	GLint uniformsCnt = 0, maxNameLength = 0;
+	glGetProgramiv( mProgramID, GL_ACTIVE_UNIFORMS, &uniformsCnt );
+	glGetProgramiv( mProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength );
+	std::vector<GLchar> nameBuffer( std::max( 1, maxNameLength ) );
+
+	for (GLint i = 0; i < uniformsCnt; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform( mProgramID, i, nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data() );
+		std::string name( nameBuffer.data(), nameLength );
+
+		//arrays of basic types are reported once as "name[0]", their elements are resolved one by one
+		std::string baseName = name;
+		bool isArray = name.size() > 3 && name.compare( name.size() - 3, 3, "[0]" ) == 0;
+		if (isArray) baseName = name.substr( 0, name.size() - 3 );
+		for (GLint element = 0; element < (isArray ? size : 1); element++)
+		{
+			std::string elementName = isArray ? baseName + "[" + std::to_string( element ) + "]" : name;
+			uniformSlot slot;
+			slot.location = glGetUniformLocation( mProgramID, elementName.c_str() );
+			if (slot.location < 0) continue;
+			uniformHandles[elementName] = uniforms.size();
+			if (isArray && element == 0) uniformHandles[baseName] = uniforms.size();
+			uniforms.push_back( slot );
+		}
+	}
+}
+
 void ShaderProgram::printProgramLog( GLuint program )
 {
 	//make sure name is shader
@@ -10,7 +10,10 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL_opengl.h>
 #include <GL/gl.h>
 #include <stdio.h>
+#include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 class ShaderProgram
 {
@@ -86,63 +89,122 @@ public:
 		-None
 	*/
 
-	// Utility uniform functions
+	int getUniformHandle(const std::string &name) const;
+	/*
+	Pre Condition:
+		-A loaded shader program
+	Post Condition:
+		-Returns the handle of an active uniform, resolved once after linking
+		-Returns -1 if the program has no such active uniform
+	Side Effects:
+		-None
+	*/
+
+	// Utility uniform functions, by handle
+	// values equal to the last one set on the same uniform of this program are not uploaded again
+	// ------------------------------------------------------------------------
+	void setBool(int handle, bool value)
+	{
+		setInt(handle, (int)value);
+	}
 	// ------------------------------------------------------------------------
-	void setBool(const std::string &name, bool value) const
+	void setInt(int handle, int value)
+	{
+		if (changes(handle, &value, sizeof(value))) glUniform1i(uniforms[handle].location, value);
+	}
+	// ------------------------------------------------------------------------
+	void setFloat(int handle, float value)
+	{
+		if (changes(handle, &value, sizeof(value))) glUniform1f(uniforms[handle].location, value);
+	}
+	// ------------------------------------------------------------------------
+	void setVec2(int handle, const glm::vec2 &value)
+	{
+		if (changes(handle, &value[0], 2 * sizeof(float))) glUniform2fv(uniforms[handle].location, 1, &value[0]);
+	}
+	// ------------------------------------------------------------------------
+	void setVec3(int handle, const glm::vec3 &value)
+	{
+		if (changes(handle, &value[0], 3 * sizeof(float))) glUniform3fv(uniforms[handle].location, 1, &value[0]);
+	}
+	// ------------------------------------------------------------------------
+	void setVec4(int handle, const glm::vec4 &value)
+	{
+		if (changes(handle, &value[0], 4 * sizeof(float))) glUniform4fv(uniforms[handle].location, 1, &value[0]);
+	}
+	// ------------------------------------------------------------------------
+	void setMat2(int handle, const glm::mat2 &mat)
+	{
+		if (changes(handle, &mat[0][0], 4 * sizeof(float))) glUniformMatrix2fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+	// ------------------------------------------------------------------------
+	void setMat3(int handle, const glm::mat3 &mat)
+	{
+		if (changes(handle, &mat[0][0], 9 * sizeof(float))) glUniformMatrix3fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+	// ------------------------------------------------------------------------
+	void setMat4(int handle, const glm::mat4 &mat)
+	{
+		if (changes(handle, &mat[0][0], 16 * sizeof(float))) glUniformMatrix4fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+
+	// Utility uniform functions, by name
+	// ------------------------------------------------------------------------
+	void setBool(const std::string &name, bool value)
 	{         
-		glUniform1i(glGetUniformLocation(mProgramID, name.c_str()), (int)value); 
+		setBool(getUniformHandle(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setInt(const std::string &name, int value) const
+	void setInt(const std::string &name, int value)
 	{ 
-		glUniform1i(glGetUniformLocation(mProgramID, name.c_str()), value); 
+		setInt(getUniformHandle(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setFloat(const std::string &name, float value) const
+	void setFloat(const std::string &name, float value)
 	{ 
-		glUniform1f(glGetUniformLocation(mProgramID, name.c_str()), value); 
+		setFloat(getUniformHandle(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setVec2(const std::string &name, const glm::vec2 &value) const
+	void setVec2(const std::string &name, const glm::vec2 &value)
 	{ 
-		glUniform2fv(glGetUniformLocation(mProgramID, name.c_str()), 1, &value[0]); 
+		setVec2(getUniformHandle(name), value);
 	}
-	void setVec2(const std::string &name, float x, float y) const
+	void setVec2(const std::string &name, float x, float y)
 	{ 
-		glUniform2f(glGetUniformLocation(mProgramID, name.c_str()), x, y); 
+		setVec2(getUniformHandle(name), glm::vec2(x, y));
 	}
 	// ------------------------------------------------------------------------
-	void setVec3(const std::string &name, const glm::vec3 &value) const
+	void setVec3(const std::string &name, const glm::vec3 &value)
 	{ 
-		glUniform3fv(glGetUniformLocation(mProgramID, name.c_str()), 1, &value[0]); 
+		setVec3(getUniformHandle(name), value);
 	}
-	void setVec3(const std::string &name, float x, float y, float z) const
+	void setVec3(const std::string &name, float x, float y, float z)
 	{ 
-		glUniform3f(glGetUniformLocation(mProgramID, name.c_str()), x, y, z); 
+		setVec3(getUniformHandle(name), glm::vec3(x, y, z));
 	}
 	// ------------------------------------------------------------------------
-	void setVec4(const std::string &name, const glm::vec4 &value) const
+	void setVec4(const std::string &name, const glm::vec4 &value)
 	{ 
-		glUniform4fv(glGetUniformLocation(mProgramID, name.c_str()), 1, &value[0]); 
+		setVec4(getUniformHandle(name), value);
 	}
-	void setVec4(const std::string &name, float x, float y, float z, float w) const
+	void setVec4(const std::string &name, float x, float y, float z, float w)
 	{ 
-		glUniform4f(glGetUniformLocation(mProgramID, name.c_str()), x, y, z, w); 
+		setVec4(getUniformHandle(name), glm::vec4(x, y, z, w));
 	}
 	// ------------------------------------------------------------------------
-	void setMat2(const std::string &name, const glm::mat2 &mat) const
+	void setMat2(const std::string &name, const glm::mat2 &mat)
 	{
-		glUniformMatrix2fv(glGetUniformLocation(mProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat2(getUniformHandle(name), mat);
 	}
 	// ------------------------------------------------------------------------
-	void setMat3(const std::string &name, const glm::mat3 &mat) const
+	void setMat3(const std::string &name, const glm::mat3 &mat)
 	{
-		glUniformMatrix3fv(glGetUniformLocation(mProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat3(getUniformHandle(name), mat);
 	}
 	// ------------------------------------------------------------------------
-	void setMat4(const std::string &name, const glm::mat4 &mat) const
+	void setMat4(const std::string &name, const glm::mat4 &mat)
 	{
-		glUniformMatrix4fv(glGetUniformLocation(mProgramID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat4(getUniformHandle(name), mat);
 	}
 
 protected:
@@ -179,10 +241,43 @@ protected:
 		-None
 	*/
 
+	void cacheUniforms();
+	/*
+	Pre Condition:
+		-A linked shader program
+	Post Condition:
+		-Resolves the locations of all active uniforms, elements of arrays included, and forgets the values set before
+	Side Effects:
+		-None
+	*/
+
 	//Program ID
 	GLuint mProgramID;
 
 	bool isBound = false;
+
+private:
+	//location of an active uniform and the last value set on it, up to a 4x4 matrix
+	typedef struct uniformSlot
+	{
+		GLint location = -1;
+		bool isSet = false;
+		unsigned char value[16 * sizeof(float)];
+	} uniformSlot;
+
+	std::vector<uniformSlot> uniforms;
+	std::unordered_map<std::string, int> uniformHandles;
+
+	//true if the handle is valid and the value differs from the last one set on the uniform, which it then replaces
+	bool changes(int handle, const void* value, size_t size)
+	{
+		if (handle < 0) return false;
+		uniformSlot& slot = uniforms[handle];
+		if (slot.isSet && std::memcmp(slot.value, value, size) == 0) return false;
+		std::memcpy(slot.value, value, size);
+		slot.isSet = true;
+		return true;
+	}
 };
 
 #endif
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+#include "Constructs3D.h"
+#include "Frustum.h"
+#include "SceneSnapshot.h"
+#include "VertexArena.h"
+
+//the models that never move, merged per material into the chunks of a grid of the world, each drawn with a single call:
+//the triangles of the models a chunk holds are moved into world space and kept as one mesh in an arena of its own,
+//a chunk is built again only when the models it holds or their meshes or transformations change, and culled as a whole
+class StaticChunks
+{
+	public:
+
+		StaticChunks() {}
+
+		StaticChunks(float chunkSize) : chunkSize(chunkSize) {}
+
+		//creates the arena of the merged meshes, needs the OpenGL context
+		void init()
+		{
+			arena.init();
+		}
+
+		//merges the models the predicate holds static into the chunks their centers fall in, builds again the chunks that changed,
+		//drops the chunks left empty and uploads the merged meshes built again, resolve gives the draw of a chunk its material
+		template <typename F, typename R> void update(const std::vector<std::shared_ptr<model>>& models, F isStatic, R resolve)
+		{
+			std::map<chunkKey, std::vector<const model*>> members;
+			merged.clear();
+			for (auto& ptrModel : models)
+			{
+				if (!ptrModel || ptrModel->removeFlag || !isStatic(*ptrModel)) continue;
+				members[keyOf(*ptrModel)].push_back(ptrModel.get());
+				merged.insert(ptrModel.get());
+			}
+
+			for (auto itr = chunks.begin(); itr != chunks.end();)
+			{
+				if (members.count(itr->first)) itr++;
+				else itr = chunks.erase(itr);
+			}
+
+			meshes.clear();
+			for (auto& m : members)
+			{
+				chunk& c = chunks[m.first];
+				uint64_t signature = signatureOf(m.second);
+				if (!c.mesh || c.signature != signature)
+				{
+					build(c, m.first, m.second);
+					c.signature = signature;
+					rebuiltCnt++;
+				}
+				meshes.push_back(c.mesh);
+			}
+
+			arena.update(meshes, [](const model&) { return true; });
+			//the arena has written where the merged meshes are, the draws take it from there
+			for (auto& c : chunks)
+			{
+				c.second.item = drawItem(*c.second.mesh, 0.0f);
+				resolve(c.second.item, *c.second.mesh);
+			}
+		}
+
+		//true if the model is drawn as part of a chunk, not on its own
+		bool isMerged(const model* m) const
+		{
+			return merged.count(m) > 0;
+		}
+
+		//calls visit with the draw of every chunk whose bounding box intersects the frustum, the chunks of a material one after another
+		template <typename F> void forEachVisible(const frustum& f, F visit) const
+		{
+			for (auto& c : chunks)
+			{
+				if (f.intersects(c.second.box)) visit(c.second.item);
+				else culledCnt++;
+			}
+		}
+
+		GLuint getVertexArray() const
+		{
+			return arena.getVertexArray();
+		}
+
+		GLuint getIndexBuffer() const
+		{
+			return arena.getIndexBuffer();
+		}
+
+		size_t getChunksCnt() const
+		{
+			return chunks.size();
+		}
+
+		size_t getMergedCnt() const
+		{
+			return merged.size();
+		}
+
+		//chunks built again, chunks culled and vertices uploaded since the last call, for the performance counters
+		unsigned long takeRebuiltCnt()
+		{
+			unsigned long cnt = rebuiltCnt;
+			rebuiltCnt = 0;
+			return cnt;
+		}
+
+		unsigned long takeCulledCnt()
+		{
+			unsigned long cnt = culledCnt;
+			culledCnt = 0;
+			return cnt;
+		}
+
+		unsigned long takeUploadedCnt()
+		{
+			return arena.takeUploadedCnt();
+		}
+
+		void free()
+		{
+			arena.free();
+			chunks.clear();
+			meshes.clear();
+			merged.clear();
+		}
+
+	private:
+
+		//the cell of the grid and what the draw of a chunk binds: its material, and whether its faces are seen from both sides
+		typedef struct chunkKey
+		{
+			std::string texture;
+			bool isTwoSided = false;
+			int x = 0, y = 0, z = 0;
+
+			bool operator<(const chunkKey& o) const
+			{
+				return std::tie(texture, isTwoSided, x, y, z) < std::tie(o.texture, o.isTwoSided, o.x, o.y, o.z);
+			}
+		} chunkKey;
+
+		typedef struct chunk
+		{
+			std::shared_ptr<model> mesh; //the triangles of the models held, in world space
+			boundingbox box;
+			uint64_t signature = 0; //of the models held when the mesh was built
+			drawItem item;
+		} chunk;
+
+		float chunkSize = 8.0f;
+		VertexArena arena;
+		std::map<chunkKey, chunk> chunks;
+		std::vector<std::shared_ptr<model>> meshes;
+		std::unordered_set<const model*> merged;
+		unsigned long rebuiltCnt = 0;
+		mutable unsigned long culledCnt = 0;
+
+		chunkKey keyOf(const model& m) const
+		{
+			const boundingbox& b = m.worldBBox;
+			chunkKey key;
+			key.texture = m.texture;
+			key.isTwoSided = m.modelMesh.shape == shapetype::RECTANGLE;
+			key.x = (int)std::floor((b.minX + b.maxX) * 0.5f / chunkSize);
+			key.y = (int)std::floor((b.minY + b.maxY) * 0.5f / chunkSize);
+			key.z = (int)std::floor((b.minZ + b.maxZ) * 0.5f / chunkSize);
+			return key;
+		}
+
+		//FNV-1a over the models held, their mesh revisions and their transformations, which is all the merged mesh is made of
+		static uint64_t signatureOf(const std::vector<const model*>& held)
+		{
+			uint64_t h = 14695981039346656037ull;
+			auto mix = [&h](const void* data, size_t size) {
+				for (size_t i = 0; i < size; i++) h = (h ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+			};
+			for (const model* m : held)
+			{
+				mix(&m, sizeof(m));
+				mix(&m->meshRevision, sizeof(m->meshRevision));
+				mix(&m->modelMatrix[0][0], sizeof(glm::mat4));
+			}
+			return h;
+		}
+
+		//a new mesh, so that the arena releases the range of the old one and uploads this one
+		void build(chunk& c, const chunkKey& key, const std::vector<const model*>& held)
+		{
+			c.mesh = std::make_shared<model>();
+			model& mesh = *c.mesh;
+			mesh.id = 0;
+			mesh.sn = 0;
+			mesh.texture = key.texture;
+			mesh.modelMesh.shape = key.isTwoSided ? shapetype::RECTANGLE : shapetype::CUBOID;
+			c.box = held.front()->worldBBox;
+			for (const model* m : held)
+			{
+				for (const triangle& tri : m->modelMesh.tris)
+				{
+					triangle t = tri;
+					for (int i = 0; i < 3; i++) t.p[i] = m->modelMatrix * tri.p[i];
+					mesh.modelMesh.tris.push_back(t);
+				}
+				const boundingbox& b = m->worldBBox;
+				c.box.minX = std::min(c.box.minX, b.minX); c.box.maxX = std::max(c.box.maxX, b.maxX);
+				c.box.minY = std::min(c.box.minY, b.minY); c.box.maxY = std::max(c.box.maxY, b.maxY);
+				c.box.minZ = std::min(c.box.minZ, b.minZ); c.box.maxZ = std::max(c.box.maxZ, b.maxZ);
+			}
+		}
+
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <array>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "GLStateCache.h"
+
+//the 2D maps of the materials gathered into texture arrays, so that models of different materials can be drawn with one call:
+//the materials whose maps have the same sizes and filtering share a set of four arrays (diffuse textures, lightmaps, normalmaps,
+//displacementmaps) bound to the units 0 to 3, and the shaders pick the layer of a material from an instance attribute
+class TextureArrays
+{
+	public:
+
+		typedef enum mapKind
+		{
+			DIFFUSE = 0,
+			LIGHTMAP = 1,
+			NORMALMAP = 2,
+			DISPLACEMENTMAP = 3
+		} mapKind;
+
+		static const unsigned int KINDS = 4;
+
+		//where the maps of a material are: its set of arrays (0 for none), its layer in them, and a bit (1 << kind) per map it has
+		typedef struct material
+		{
+			GLuint set = 0;
+			GLint layer = 0;
+			GLint maps = 0;
+		} material;
+
+		//keeps a decoded RGB image until build(), the filtering of a material follows its diffuse texture
+		void add(mapKind kind, const std::string& name, int width, int height, const unsigned char* rgb, bool isNearest = false)
+		{
+			pendingMaterial& m = pending[name];
+			m.images[kind].width = width;
+			m.images[kind].height = height;
+			m.images[kind].data.assign(rgb, rgb + (size_t)width * height * 3);
+			if (kind == DIFFUSE) m.isNearest = isNearest;
+		}
+
+		//creates the arrays of the images added, one layer per material, then lets the images go, needs the OpenGL context
+		//maps without a diffuse texture of the same name belong to no material and are dropped
+		void build()
+		{
+			std::map<setKey, std::vector<std::string>> groups;
+			for (auto& entry : pending)
+			{
+				if (entry.second.images[DIFFUSE].data.empty()) continue;
+				groups[keyOf(entry.second)].push_back(entry.first);
+			}
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (auto& group : groups)
+			{
+				const setKey& key = group.first;
+				const std::vector<std::string>& names = group.second;
+				arraySet s;
+				for (unsigned int kind = 0; kind < KINDS; kind++)
+				{
+					GLsizei width = std::get<0>(key)[kind], height = std::get<1>(key)[kind];
+					if (width == 0) continue;
+					glGenTextures(1, &s.arrays[kind]);
+					glBindTexture(GL_TEXTURE_2D_ARRAY, s.arrays[kind]);
+					glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, width, height, (GLsizei)names.size(), 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+					for (size_t layer = 0; layer < names.size(); layer++)
+					{
+						const image& img = pending[names[layer]].images[kind];
+						if (!img.data.empty()) glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, img.data.data());
+					}
+					glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+					glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+					glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+					if (std::get<2>(key)) { //to achieve transparency
+						glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+						glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+					} else { //filter texture
+						glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+						glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+					}
+				}
+				sets.push_back(s);
+				for (size_t layer = 0; layer < names.size(); layer++)
+				{
+					material m;
+					m.set = (GLuint)sets.size();
+					m.layer = (GLint)layer;
+					for (unsigned int kind = 0; kind < KINDS; kind++)
+					{
+						if (!pending[names[layer]].images[kind].data.empty()) m.maps |= 1 << kind;
+					}
+					materials[names[layer]] = m;
+				}
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			pending.clear();
+		}
+
+		//the material of the given name, or one without maps if there is none
+		const material& get(const std::string& name) const
+		{
+			auto itr = materials.find(name);
+			return itr == materials.end() ? none : itr->second;
+		}
+
+		//names of the materials, in alphabetical order
+		std::vector<std::string> getNames() const
+		{
+			std::vector<std::string> names;
+			for (auto& entry : materials) names.push_back(entry.first);
+			return names;
+		}
+
+		size_t getSetsCnt() const
+		{
+			return sets.size();
+		}
+
+		//binds the arrays of a set to the units 0 to 3, no arrays for the set 0
+		void bind(GLStateCache& gl, GLuint set) const
+		{
+			const arraySet& s = set > 0 && set <= sets.size() ? sets[set - 1] : empty;
+			for (unsigned int kind = 0; kind < KINDS; kind++) gl.bindTexture(kind, GL_TEXTURE_2D_ARRAY, s.arrays[kind]);
+		}
+
+		void free()
+		{
+			for (arraySet& s : sets)
+			{
+				for (unsigned int kind = 0; kind < KINDS; kind++)
+				{
+					if (s.arrays[kind]) glDeleteTextures(1, &s.arrays[kind]);
+				}
+			}
+			sets.clear();
+			materials.clear();
+			pending.clear();
+		}
+
+	private:
+
+		typedef struct image
+		{
+			int width = 0;
+			int height = 0;
+			std::vector<unsigned char> data;
+		} image;
+
+		typedef struct pendingMaterial
+		{
+			image images[KINDS];
+			bool isNearest = false;
+		} pendingMaterial;
+
+		typedef struct arraySet
+		{
+			GLuint arrays[KINDS] = { 0, 0, 0, 0 };
+		} arraySet;
+
+		//widths and heights of the maps of every kind (0 for a kind the materials lack) and nearest filtering
+		typedef std::tuple<std::array<int, KINDS>, std::array<int, KINDS>, bool> setKey;
+
+		std::map<std::string, pendingMaterial> pending;
+		std::map<std::string, material> materials;
+		std::vector<arraySet> sets;
+		material none;
+		arraySet empty;
+
+		static setKey keyOf(const pendingMaterial& m)
+		{
+			setKey key;
+			for (unsigned int kind = 0; kind < KINDS; kind++)
+			{
+				bool exists = !m.images[kind].data.empty();
+				std::get<0>(key)[kind] = exists ? m.images[kind].width : 0;
+				std::get<1>(key)[kind] = exists ? m.images[kind].height : 0;
+			}
+			std::get<2>(key) = m.isNearest;
+			return key;
+		}
+
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+//work-stealing thread pool: each worker owns a task queue, pops from its back and steals from the front of the others' when empty
+//the thread calling parallelFor owns queue 0 and takes part in the work until all its tasks are done
+class ThreadPool
+{
+	public:
+
+		//threadsCnt = 0 sizes the pool to the machine, the calling thread counts as one of the threads
+		ThreadPool(unsigned int threadsCnt = 0)
+		{
+			if (threadsCnt == 0) threadsCnt = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned int i = 0; i < threadsCnt; i++)
+			{
+				queues.push_back(std::make_unique<workQueue>());
+			}
+			for (unsigned int i = 1; i < threadsCnt; i++)
+			{
+				workers.emplace_back(&ThreadPool::workerLoop, this, i);
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMtx);
+				isStopping = true;
+			}
+			sleepCv.notify_all();
+			for (auto &worker : workers) worker.join();
+		}
+
+		unsigned int size() const
+		{
+			return queues.size();
+		}
+
+		//calls fn(begin, end) over [0, count) split in chunks of at most grain items, returns when all chunks are done
+		template<typename Function>
+		void parallelFor(size_t count, size_t grain, Function fn)
+		{
+			if (count == 0) return;
+			grain = std::max((size_t)1, grain);
+			size_t chunksCnt = (count + grain - 1) / grain;
+			if (chunksCnt == 1 || queues.size() == 1)
+			{
+				fn((size_t)0, count);
+				return;
+			}
+
+			std::atomic<size_t> remaining(chunksCnt);
+			for (size_t c = 0; c < chunksCnt; c++)
+			{
+				size_t begin = c * grain;
+				size_t end = std::min(count, begin + grain);
+				workQueue& q = *queues[c % queues.size()];
+				std::lock_guard<std::mutex> lock(q.mtx);
+				q.tasks.push_back([&fn, &remaining, begin, end]() {
+					fn(begin, end);
+					remaining--;
+				});
+				pendingTasks++;
+			}
+			{
+				std::lock_guard<std::mutex> lock(sleepMtx);
+			}
+			sleepCv.notify_all();
+
+			while (remaining > 0)
+			{
+				if (!runTask(0)) std::this_thread::yield();
+			}
+		}
+
+	private:
+
+		typedef struct workQueue
+		{
+			std::mutex mtx;
+			std::deque<std::function<void()>> tasks;
+		} workQueue;
+
+		std::vector<std::unique_ptr<workQueue>> queues;
+		std::vector<std::thread> workers;
+
+		std::mutex sleepMtx;
+		std::condition_variable sleepCv;
+		std::atomic<size_t> pendingTasks{0};
+		bool isStopping = false;
+
+		//runs one task from the own queue, or steals one from another queue, returns false if none found
+		bool runTask(unsigned int index)
+		{
+			std::function<void()> task;
+			{
+				workQueue& own = *queues[index];
+				std::lock_guard<std::mutex> lock(own.mtx);
+				if (!own.tasks.empty())
+				{
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+				}
+			}
+			for (unsigned int i = 1; !task && i < queues.size(); i++)
+			{
+				workQueue& victim = *queues[(index + i) % queues.size()];
+				std::lock_guard<std::mutex> lock(victim.mtx);
+				if (!victim.tasks.empty())
+				{
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+				}
+			}
+			if (!task) return false;
+			pendingTasks--;
+			task();
+			return true;
+		}
+
+		void workerLoop(unsigned int index)
+		{
+			while (true)
+			{
+				if (runTask(index)) continue;
+				std::unique_lock<std::mutex> lock(sleepMtx);
+				sleepCv.wait(lock, [this]() { return isStopping || pendingTasks > 0; });
+				if (isStopping) return;
+			}
+		}
+
+};
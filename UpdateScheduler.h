@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <algorithm>
+
+typedef enum updatetier {
+	EVERY_TICK,
+	EVERY_INTERVAL,
+	ON_CELL_CHANGE,
+	UPDATE_TIERS_CNT
+} updatetier;
+
+//decides how often the models in range are updated, by their distance from the camera:
+//near models every tick, mid-distance ones every few ticks and far ones once after the camera moved to another cell
+//the slower tiers are staggered by model handle, so that their work is spread evenly over the ticks instead of spiking
+class UpdateScheduler
+{
+	public:
+
+		UpdateScheduler(float nearDistance = 2.0f, float farDistance = 10.0f, unsigned int interval = 3, float cellSize = 2.0f)
+		: nearDistanceSq(nearDistance * nearDistance), farDistanceSq(farDistance * farDistance),
+		  interval(std::max(1u, interval)), cellSize(std::max(0.001f, cellSize)) {}
+
+		//advances to the given tick, starts a new cell epoch if the camera moved to another cell
+		void beginTick(unsigned long tick, glm::vec3 cameraPos)
+		{
+			currentTick = tick;
+			long x = (long)std::floor(cameraPos.x / cellSize);
+			long y = (long)std::floor(cameraPos.y / cellSize);
+			long z = (long)std::floor(cameraPos.z / cellSize);
+			if (x != cellX || y != cellY || z != cellZ)
+			{
+				cellX = x; cellY = y; cellZ = z;
+				cellEpoch++;
+			}
+		}
+
+		//tier of a model by its squared distance from the camera
+		updatetier classify(float distanceSq) const
+		{
+			if (distanceSq < nearDistanceSq) return updatetier::EVERY_TICK;
+			if (distanceSq < farDistanceSq) return updatetier::EVERY_INTERVAL;
+			return updatetier::ON_CELL_CHANGE;
+		}
+
+		//true if a model of the given tier, last updated in the given cell epoch, is due this tick
+		bool isDue(int handle, updatetier tier, unsigned long updatedCellEpoch) const
+		{
+			if (tier == updatetier::EVERY_TICK) return true;
+			bool isTurn = (currentTick + handle) % interval == 0;
+			if (tier == updatetier::EVERY_INTERVAL) return isTurn;
+			return isTurn && updatedCellEpoch != cellEpoch;
+		}
+
+		unsigned long getCellEpoch() const
+		{
+			return cellEpoch;
+		}
+
+	private:
+
+		float nearDistanceSq;
+		float farDistanceSq;
+		unsigned int interval;
+		float cellSize;
+
+		unsigned long currentTick = 0;
+		long cellX = 0, cellY = 0, cellZ = 0;
+		unsigned long cellEpoch = 1; //models start with epoch 0, so they are all due once after registration
+};
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Constructs3D.h"
+#include "VertexLayout.h"
+
+//vertices and indices of the models drawn with one vertex array, kept in buffers that live as long as the engine:
+//every model owns a range of vertices and a range of indices, a new or changed mesh gets ranges and only those are uploaded,
+//the ranges of removed models go to free lists the next meshes are fitted into, and the buffers grow by copying on the GPU
+//the vertices the triangles of a mesh share are stored once, its indices count from the first vertex of its range (the base vertex)
+class VertexArena
+{
+	public:
+
+		static const GLsizei VERTEX_SIZE = meshVertex::SIZE;
+		static const GLuint MIN_COMPACTED_VERTICES = 16384; //free vertices or indices below which the arena is never compacted
+
+		//creates the vertex array and its buffers, needs the OpenGL context
+		void init(GLuint initialCapacity = 16384)
+		{
+			glGenVertexArrays(1, &vao);
+			grow(vbo, vertexCapacity, std::max(1u, initialCapacity), VERTEX_SIZE);
+			grow(ibo, indexCapacity, std::max(1u, initialCapacity), sizeof(GLuint));
+			pointVertexArray();
+		}
+
+		//brings the buffers in line with the models the predicate holds: releases the ranges of the models gone, removed or
+		//with another mesh, uploads the meshes without ranges, and writes the first index and base vertex into every model
+		template <typename F> void update(const std::vector<std::shared_ptr<model>>& models, F holds)
+		{
+			updateStamp++;
+			std::vector<model*> changed;
+			for (auto& ptrModel : models)
+			{
+				if (!ptrModel || ptrModel->removeFlag || !holds(*ptrModel)) continue;
+				model& m = *ptrModel;
+				auto itr = ranges.find(&m);
+				if (itr != ranges.end() && itr->second.revision == m.meshRevision && itr->second.indexCount == m.modelMesh.tris.size() * 3)
+				{
+					itr->second.stamp = updateStamp;
+					m.sn = itr->second.firstIndex;
+					m.baseVertex = itr->second.firstVertex;
+					continue;
+				}
+				changed.push_back(&m);
+			}
+
+			//release first, so that the changed meshes can take the ranges given back
+			for (auto itr = ranges.begin(); itr != ranges.end();)
+			{
+				if (itr->second.stamp == updateStamp) { itr++; continue; }
+				vertices.release(itr->second.firstVertex, itr->second.vertexCount);
+				indices.release(itr->second.firstIndex, itr->second.indexCount);
+				itr = ranges.erase(itr);
+				generation++;
+			}
+
+			for (model* m : changed)
+			{
+				pack(*m);
+				range r;
+				r.vertexCount = vertexData.size() / VERTEX_SIZE;
+				r.indexCount = indexData.size();
+				r.firstVertex = vertices.allocate(r.vertexCount);
+				r.firstIndex = indices.allocate(r.indexCount);
+				r.revision = m->meshRevision;
+				r.stamp = updateStamp;
+				bool isGrown = vertices.end > vertexCapacity && grow(vbo, vertexCapacity, std::max(vertices.end, vertexCapacity * 2), VERTEX_SIZE);
+				if (indices.end > indexCapacity && grow(ibo, indexCapacity, std::max(indices.end, indexCapacity * 2), sizeof(GLuint))) isGrown = true;
+				if (isGrown) pointVertexArray();
+				ranges[m] = r;
+				m->sn = r.firstIndex;
+				m->baseVertex = r.firstVertex;
+				upload(r);
+			}
+
+			if (isFragmented(vertices) || isFragmented(indices)) compact();
+		}
+
+		//true if the current mesh of the model is in the buffers, so that its first index and base vertex point at it
+		bool isUploaded(const model& m) const
+		{
+			auto itr = ranges.find(const_cast<model*>(&m));
+			return itr != ranges.end() && itr->second.revision == m.meshRevision && itr->second.indexCount == m.modelMesh.tris.size() * 3;
+		}
+
+		//changes whenever ranges are given back or moved, the first indices and base vertices copied before may point elsewhere then
+		unsigned long getGeneration() const
+		{
+			return generation;
+		}
+
+		//writes where the given mesh of the model is now, returns false if the arena no longer has it
+		bool locate(const model* m, unsigned long meshRevision, unsigned long& firstIndex, unsigned long& baseVertex) const
+		{
+			auto itr = ranges.find(const_cast<model*>(m));
+			if (itr == ranges.end() || itr->second.revision != meshRevision) return false;
+			firstIndex = itr->second.firstIndex;
+			baseVertex = itr->second.firstVertex;
+			return true;
+		}
+
+		GLuint getVertexArray() const
+		{
+			return vao;
+		}
+
+		GLuint getIndexBuffer() const
+		{
+			return ibo;
+		}
+
+		//vertices uploaded, vertices saved by sharing them between triangles and compactions since the last call, for the performance counters
+		unsigned long takeUploadedCnt()
+		{
+			unsigned long cnt = uploadedCnt;
+			uploadedCnt = 0;
+			return cnt;
+		}
+
+		unsigned long takeSharedCnt()
+		{
+			unsigned long cnt = sharedCnt;
+			sharedCnt = 0;
+			return cnt;
+		}
+
+		unsigned long takeCompactionsCnt()
+		{
+			unsigned long cnt = compactionsCnt;
+			compactionsCnt = 0;
+			return cnt;
+		}
+
+		void free()
+		{
+			if (vao) glDeleteVertexArrays(1, &vao);
+			if (vbo) glDeleteBuffers(1, &vbo);
+			if (ibo) glDeleteBuffers(1, &ibo);
+			vao = vbo = ibo = 0;
+			ranges.clear();
+			vertices = rangeList();
+			indices = rangeList();
+			vertexCapacity = indexCapacity = 0;
+		}
+
+	private:
+
+		//ranges of one buffer, in elements: first fit in the free ranges, else at the end
+		typedef struct rangeList
+		{
+			std::map<GLuint, GLuint> freeRanges; //first to count, never adjacent to each other nor to end
+			GLuint end = 0; //up to the end of the last range
+			GLuint freeCnt = 0; //in the free ranges, all of them below end
+
+			GLuint allocate(GLuint count)
+			{
+				for (auto itr = freeRanges.begin(); itr != freeRanges.end(); itr++)
+				{
+					if (itr->second < count) continue;
+					GLuint first = itr->first;
+					GLuint rest = itr->second - count;
+					freeRanges.erase(itr);
+					if (rest > 0) freeRanges[first + count] = rest;
+					freeCnt -= count;
+					return first;
+				}
+				GLuint first = end;
+				end += count;
+				return first;
+			}
+
+			//gives a range back, merging it with the free ranges next to it, or shortening the used part if it was the last one
+			void release(GLuint first, GLuint count)
+			{
+				if (count == 0) return;
+				auto next = freeRanges.lower_bound(first);
+				if (next != freeRanges.end() && first + count == next->first)
+				{
+					count += next->second;
+					freeCnt -= next->second;
+					next = freeRanges.erase(next);
+				}
+				if (next != freeRanges.begin())
+				{
+					auto prev = std::prev(next);
+					if (prev->first + prev->second == first)
+					{
+						first = prev->first;
+						count += prev->second;
+						freeCnt -= prev->second;
+						freeRanges.erase(prev);
+					}
+				}
+				if (first + count == end)
+				{
+					end = first;
+					return;
+				}
+				freeRanges[first] = count;
+				freeCnt += count;
+			}
+		} rangeList;
+
+		typedef struct range
+		{
+			GLuint firstVertex = 0;
+			GLuint vertexCount = 0;
+			GLuint firstIndex = 0;
+			GLuint indexCount = 0;
+			unsigned long revision = 0; //mesh revision of the model when its vertices were uploaded
+			unsigned long stamp = 0; //last update that found the model
+		} range;
+
+		//a packed vertex, whose normal and tangent are quantized enough for the corners the triangles of a face share to compare equal
+		typedef std::array<unsigned char, VERTEX_SIZE> vertexKey;
+
+		typedef struct vertexKeyHash
+		{
+			size_t operator()(const vertexKey& k) const
+			{
+				size_t h = 14695981039346656037ull;
+				for (unsigned char c : k) h = (h ^ c) * 1099511628211ull;
+				return h;
+			}
+		} vertexKeyHash;
+
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		GLuint ibo = 0;
+		GLuint vertexCapacity = 0;
+		GLuint indexCapacity = 0;
+		rangeList vertices;
+		rangeList indices;
+		std::unordered_map<model*, range> ranges;
+		std::vector<unsigned char> vertexData;
+		std::vector<GLuint> indexData;
+		std::unordered_map<vertexKey, GLuint, vertexKeyHash> sharedVertices;
+		unsigned long updateStamp = 0;
+		unsigned long generation = 0;
+		unsigned long uploadedCnt = 0;
+		unsigned long sharedCnt = 0;
+		unsigned long compactionsCnt = 0;
+
+		bool isFragmented(const rangeList& l) const
+		{
+			return l.freeCnt >= MIN_COMPACTED_VERTICES && l.freeCnt > l.end / 2;
+		}
+
+		//packs the distinct vertices of the model and the indices of its triangles, counting from its first vertex
+		void pack(model& m)
+		{
+			vertexData.clear();
+			indexData.clear();
+			sharedVertices.clear();
+			vertexKey key;
+			for (auto& tri : m.modelMesh.tris)
+			{
+				glm::vec3 normal = glm::normalize(glm::cross(glm::vec3(tri.p[1] - tri.p[0]), glm::vec3(tri.p[2] - tri.p[0])));
+				tri.tang = tri.calcTangent();
+				for (int i = 0; i < 3; i++)
+				{
+					meshVertex::write(key.data(), glm::vec3(tri.p[i]), normal, glm::vec2(tri.t[i]), tri.tang);
+					auto shared = sharedVertices.emplace(key, (GLuint)(vertexData.size() / VERTEX_SIZE));
+					if (shared.second) vertexData.insert(vertexData.end(), key.begin(), key.end());
+					else sharedCnt++;
+					indexData.push_back(shared.first->second);
+				}
+			}
+		}
+
+		//uploads the packed vertices and indices to their ranges
+		void upload(const range& r)
+		{
+			if (!vertexData.empty())
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+				glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)r.firstVertex * VERTEX_SIZE, vertexData.size(), vertexData.data());
+			}
+			if (!indexData.empty())
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+				glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)r.firstIndex * sizeof(GLuint), indexData.size() * sizeof(GLuint), indexData.data());
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			uploadedCnt += r.vertexCount;
+		}
+
+		//moves a buffer to a new one of the given capacity, copying the old one on the GPU, returns true if it was moved
+		bool grow(GLuint& buffer, GLuint& capacity, GLuint newCapacity, GLsizeiptr elementSize)
+		{
+			if (newCapacity <= capacity) return false;
+			GLuint newBuffer = 0;
+			glGenBuffers(1, &newBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newCapacity * elementSize, nullptr, GL_DYNAMIC_DRAW);
+			if (buffer)
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)capacity * elementSize);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+				glDeleteBuffers(1, &buffer);
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			buffer = newBuffer;
+			capacity = newCapacity;
+			return true;
+		}
+
+		//packs the ranges to the start of new buffers of the same capacities in their current order, copying on the GPU
+		//indices count from the base vertex of their model, so they move unchanged
+		void compact()
+		{
+			std::vector<std::pair<model*, range*>> order;
+			for (auto& r : ranges) order.push_back({ r.first, &r.second });
+			std::sort(order.begin(), order.end(), [](const std::pair<model*, range*>& a, const std::pair<model*, range*>& b) { return a.second->firstVertex < b.second->firstVertex; });
+
+			GLuint newVbo = 0, newIbo = 0;
+			glGenBuffers(1, &newVbo);
+			glGenBuffers(1, &newIbo);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+			glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * VERTEX_SIZE, nullptr, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, newIbo);
+			glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+			GLuint firstVertex = 0, firstIndex = 0;
+			for (auto& o : order)
+			{
+				range& r = *o.second;
+				copyRange(vbo, newVbo, r.firstVertex, firstVertex, r.vertexCount, VERTEX_SIZE);
+				copyRange(ibo, newIbo, r.firstIndex, firstIndex, r.indexCount, sizeof(GLuint));
+				r.firstVertex = firstVertex;
+				r.firstIndex = firstIndex;
+				o.first->sn = firstIndex;
+				o.first->baseVertex = firstVertex;
+				firstVertex += r.vertexCount;
+				firstIndex += r.indexCount;
+			}
+			glDeleteBuffers(1, &vbo);
+			glDeleteBuffers(1, &ibo);
+			vbo = newVbo;
+			ibo = newIbo;
+			vertices = rangeList();
+			vertices.end = firstVertex;
+			indices = rangeList();
+			indices.end = firstIndex;
+			pointVertexArray();
+			compactionsCnt++;
+			generation++;
+		}
+
+		void copyRange(GLuint from, GLuint to, GLuint first, GLuint newFirst, GLuint count, GLsizeiptr elementSize)
+		{
+			if (count == 0) return;
+			glBindBuffer(GL_COPY_READ_BUFFER, from);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)first * elementSize, (GLintptr)newFirst * elementSize, (GLsizeiptr)count * elementSize);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+
+		//the vertex array keeps the buffers its attributes and indices were pointed at, so it is pointed again after they are replaced
+		void pointVertexArray()
+		{
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+			meshVertex::pointAttributes();
+			//the color is not streamed, it is the constant value of its attribute, white like the triangles of every mesh
+			glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+//formats a vertex attribute can be stored in, each with its size in bytes, how it writes a value and how an attribute is pointed at it
+
+//three floats, for positions
+typedef struct float3Format
+{
+	typedef glm::vec3 value;
+	static const GLsizei SIZE = 12;
+
+	static void write(unsigned char* dst, const glm::vec3& v)
+	{
+		std::memcpy(dst, &v[0], SIZE);
+	}
+
+	static void point(GLuint location, GLsizei stride, size_t offset)
+	{
+		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+	}
+} float3Format;
+
+//a unit vector in 10 signed normalized bits per component, for normals and tangents
+//vectors that cannot be normalized are stored as +x, so that the shaders still get a direction to build their frames from
+typedef struct snorm3Format
+{
+	typedef glm::vec3 value;
+	static const GLsizei SIZE = 4;
+
+	static void write(unsigned char* dst, const glm::vec3& v)
+	{
+		float length = glm::length(v);
+		glm::vec3 n = std::isfinite(length) && length > 1e-12f ? v / length : glm::vec3(1.0f, 0.0f, 0.0f);
+		uint32_t packed = component(n.x) | component(n.y) << 10 | component(n.z) << 20;
+		std::memcpy(dst, &packed, SIZE);
+	}
+
+	static void point(GLuint location, GLsizei stride, size_t offset)
+	{
+		glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offset);
+	}
+
+	private:
+
+		static uint32_t component(float c)
+		{
+			return (uint32_t)(int32_t)std::lround(std::max(-1.0f, std::min(1.0f, c)) * 511.0f) & 0x3FF;
+		}
+} snorm3Format;
+
+//two half floats, for texture coordinates, which stay within a few units of 0
+typedef struct half2Format
+{
+	typedef glm::vec2 value;
+	static const GLsizei SIZE = 4;
+
+	static void write(unsigned char* dst, const glm::vec2& v)
+	{
+		uint16_t packed[2] = { half(v.x), half(v.y) };
+		std::memcpy(dst, packed, SIZE);
+	}
+
+	static void point(GLuint location, GLsizei stride, size_t offset)
+	{
+		glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offset);
+	}
+
+	private:
+
+		//rounds to the nearest half float, flushing what is too small for a normal half to zero and what is too large to infinity
+		static uint16_t half(float f)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &f, sizeof(bits));
+			uint16_t sign = (bits >> 16) & 0x8000;
+			int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+			uint32_t mantissa = bits & 0x7FFFFF;
+			if (((bits >> 23) & 0xFF) == 0xFF) return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+			if (exponent <= 0) return sign;
+			uint32_t rounded = ((uint32_t)exponent << 10 | mantissa >> 13) + ((mantissa >> 12) & 1);
+			if (rounded >= 0x7C00) return sign | 0x7C00;
+			return sign | (uint16_t)rounded;
+		}
+} half2Format;
+
+//four unsigned normalized bytes, for colors
+typedef struct unorm4Format
+{
+	typedef glm::vec4 value;
+	static const GLsizei SIZE = 4;
+
+	static void write(unsigned char* dst, const glm::vec4& v)
+	{
+		for (int i = 0; i < 4; i++) dst[i] = (unsigned char)std::lround(std::max(0.0f, std::min(1.0f, v[i])) * 255.0f);
+	}
+
+	static void point(GLuint location, GLsizei stride, size_t offset)
+	{
+		glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offset);
+	}
+} unorm4Format;
+
+//an attribute of a vertex layout: the shader location and the format it is stored in
+template <GLuint LOCATION, typename FORMAT>
+struct vertexAttribute
+{
+	static const GLuint location = LOCATION;
+	typedef FORMAT format;
+};
+
+//interleaved vertex of the given attributes in the given order, with the packing of a vertex and the attribute setup both derived from the list
+template <typename... ATTRIBUTES>
+struct vertexLayout
+{
+	static const GLsizei SIZE = (0 + ... + ATTRIBUTES::format::SIZE);
+
+	//writes the values of one vertex, in the order of the attributes
+	static void write(unsigned char* dst, const typename ATTRIBUTES::format::value&... values)
+	{
+		size_t offset = 0;
+		((ATTRIBUTES::format::write(dst + offset, values), offset += ATTRIBUTES::format::SIZE), ...);
+	}
+
+	//points and enables the attributes of the bound vertex array at the bound array buffer
+	static void pointAttributes()
+	{
+		size_t offset = 0;
+		((ATTRIBUTES::format::point(ATTRIBUTES::location, SIZE, offset), glEnableVertexAttribArray(ATTRIBUTES::location), offset += ATTRIBUTES::format::SIZE), ...);
+	}
+};
+
+//the vertices of the model meshes: position, normal, texture coordinates and tangent, 24 bytes
+//the meshes are all white, so the color (location 2) is not streamed but left to the constant value of the attribute
+typedef vertexLayout<
+	vertexAttribute<0, float3Format>,
+	vertexAttribute<1, snorm3Format>,
+	vertexAttribute<3, half2Format>,
+	vertexAttribute<4, snorm3Format>
+> meshVertex;
+
+static_assert(meshVertex::SIZE == 24, "mesh vertices are meant to take 24 bytes");
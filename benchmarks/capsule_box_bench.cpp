@@ -0,0 +1,123 @@
+//check of the closed-form capsule against oriented box test against dense sampling of the segment, and its cost per test
+//random capsules and boxes, quads among them, sorted by the sampled result into separated, touching and penetrating ones
+//run with "make bench-collision", exits with 1 if any test disagrees with the sampling
+
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../Collision.h"
+
+const int CASES_CNT = 20000;
+const int SAMPLES_CNT = 20000; //points along the segment the reference tests
+const int ITERATIONS = 50;
+const float SKIN = 0.05f;
+const float TOLERANCE = 1e-3f;
+
+typedef struct testCase
+{
+	capsule c;
+	orientedbox box;
+} testCase;
+
+//reference: the distance from the box of every sampled point of the segment, and while the segment is inside the box,
+//for every face the depth of the deepest sampled point below it, the capsule leaving through the face with the least
+float penetrationReference(const capsule& c, const orientedbox& box)
+{
+	glm::vec3 a = box.toLocal(c.a), b = box.toLocal(c.b);
+	const glm::vec3& h = box.halfExtents;
+	float minDist = FLT_MAX;
+	float faceDepths[6] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	bool isInside = false;
+	for (int s = 0; s <= SAMPLES_CNT; s++)
+	{
+		glm::vec3 p = a + (b - a) * ((float)s / SAMPLES_CNT);
+		glm::vec3 d = p - box.clampLocal(p);
+		float dist = glm::length(d);
+		minDist = std::min(minDist, dist);
+		if (dist > 0.0f) continue;
+		isInside = true;
+		for (int i = 0; i < 3; i++)
+		{
+			faceDepths[i * 2] = std::max(faceDepths[i * 2], h[i] - p[i]);
+			faceDepths[i * 2 + 1] = std::max(faceDepths[i * 2 + 1], h[i] + p[i]);
+		}
+	}
+	if (!isInside) return c.radius - minDist;
+	float depth = FLT_MAX;
+	for (int f = 0; f < 6; f++) depth = std::min(depth, faceDepths[f]);
+	return c.radius + depth;
+}
+
+//a box of random size and orientation around a random center, one in four a quad
+orientedbox randomBox(std::mt19937& rng, int k)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f), extent(0.05f, 1.5f);
+	orientedbox box;
+	box.center = glm::vec3(unit(rng), unit(rng), unit(rng));
+	glm::vec3 x = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+	glm::vec3 y = glm::normalize(glm::cross(x, glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(1e-3f, 0.0f, 0.0f))));
+	box.axes[0] = x;
+	box.axes[1] = y;
+	box.axes[2] = glm::cross(x, y);
+	box.halfExtents = glm::vec3(extent(rng), extent(rng), extent(rng));
+	if (k % 4 == 0) box.halfExtents[k / 4 % 3] = 0.0f;
+	return box;
+}
+
+int main()
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> spread(-3.0f, 3.0f), radius(0.05f, 0.6f);
+	std::vector<testCase> cases;
+	cases.reserve(CASES_CNT);
+	for (int k = 0; k < CASES_CNT; k++)
+	{
+		testCase t;
+		t.box = randomBox(rng, k);
+		t.c.a = glm::vec3(spread(rng), spread(rng), spread(rng));
+		//one in seven a sphere, the segment shrunk to a point
+		t.c.b = k % 7 == 0 ? t.c.a : glm::vec3(spread(rng), spread(rng), spread(rng));
+		t.c.radius = radius(rng);
+		cases.push_back(t);
+	}
+
+	const char* kinds[3] = { "separated", "touching", "penetrating" };
+	int counts[3] = { 0, 0, 0 }, quadCounts[3] = { 0, 0, 0 }, mismatches[3] = { 0, 0, 0 };
+	for (int k = 0; k < CASES_CNT; k++)
+	{
+		const testCase& t = cases[k];
+		float expected = penetrationReference(t.c, t.box);
+		contact r = collision::capsuleVsBox(t.c, t.box, SKIN);
+		int kind = expected > 0.0f ? 2 : (expected > -SKIN ? 1 : 0);
+		counts[kind]++;
+		if (t.box.halfExtents.x == 0.0f || t.box.halfExtents.y == 0.0f || t.box.halfExtents.z == 0.0f) quadCounts[kind]++;
+		//the sampling misses the closest point by up to half a step along the segment
+		float step = glm::length(t.c.b - t.c.a) / SAMPLES_CNT;
+		bool isMatching = std::fabs(r.penetration - expected) <= TOLERANCE + step
+			&& std::fabs(glm::length(r.normal) - 1.0f) <= TOLERANCE
+			&& (r.isTouching == (expected > -SKIN) || std::fabs(expected + SKIN) <= TOLERANCE + step);
+		if (isMatching) continue;
+		if (mismatches[kind]++ < 5) printf("MISMATCH case %d: sampled %f closed form %f\n", k, expected, r.penetration);
+	}
+
+	printf("%d capsules against boxes, %d samples per segment\n", CASES_CNT, SAMPLES_CNT);
+	int mismatchesCnt = 0;
+	for (int kind = 0; kind < 3; kind++)
+	{
+		printf("%-12s %6d (%5d quads) %s\n", kinds[kind], counts[kind], quadCounts[kind], mismatches[kind] ? "MISMATCH" : "ok");
+		mismatchesCnt += mismatches[kind];
+	}
+
+	float sink = 0.0f;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		for (const testCase& t : cases) sink += collision::capsuleVsBox(t.c, t.box, SKIN).penetration;
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS / CASES_CNT;
+	printf("closed form %8.3f ns/test (%f)\n", ns, sink);
+	return mismatchesCnt ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+//microbenchmark of the clip-space kernel against the per-vertex glm loop it replaced
+//generates a scene of 100k triangles in cubes scattered around the camera, run with "make bench"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../ClipKernel.h"
+
+const size_t TRIANGLES_CNT = 100000;
+const int ITERATIONS = 50;
+
+//reference: the previous loop, distances with glm::distance and one matrix-vector product per vertex
+void clipTrianglesReference(const std::vector<glm::vec4>& worldVertices, const glm::mat4& m, glm::vec3 eye, clipResult& r)
+{
+	size_t trisCnt = worldVertices.size() / 3;
+	for (size_t t = 0; t < trisCnt; t++)
+	{
+		glm::vec4 pt[3] = { worldVertices[t * 3], worldVertices[t * 3 + 1], worldVertices[t * 3 + 2] };
+
+		float minDist = std::min(glm::distance(eye, glm::vec3(pt[0])), std::min(glm::distance(eye, glm::vec3(pt[1])), glm::distance(eye, glm::vec3(pt[2]))));
+		r.minVertexDistSq = std::min(r.minVertexDistSq, minDist * minDist);
+
+		for (int v = 0; v < 3; v++)
+		{
+			pt[v] = m * pt[v];
+			r.minX = std::min(r.minX, pt[v].x / pt[v].w); r.maxX = std::max(r.maxX, pt[v].x / pt[v].w);
+			r.minY = std::min(r.minY, pt[v].y / pt[v].w); r.maxY = std::max(r.maxY, pt[v].y / pt[v].w);
+			r.minZ = std::min(r.minZ, pt[v].z); r.maxZ = std::max(r.maxZ, pt[v].z);
+		}
+	}
+}
+
+bool isClose(float a, float b)
+{
+	return std::fabs(a - b) <= 1e-3f * std::max(1.0f, std::max(std::fabs(a), std::fabs(b)));
+}
+
+bool matches(const clipResult& a, const clipResult& b)
+{
+	return isClose(a.minX, b.minX) && isClose(a.maxX, b.maxX) && isClose(a.minY, b.minY) && isClose(a.maxY, b.maxY)
+		&& isClose(a.minZ, b.minZ) && isClose(a.maxZ, b.maxZ)
+		&& isClose(a.minVertexDistSq, b.minVertexDistSq);
+}
+
+template<typename Function>
+double measure(const char* name, Function fn, const clipResult& expected, double baseline)
+{
+	clipResult r;
+	fn(r);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		r = clipResult();
+		fn(r);
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS / TRIANGLES_CNT;
+	printf("%-10s %8.3f ns/triangle %6.2fx %s\n", name, ns, baseline > 0.0 ? baseline / ns : 1.0, matches(r, expected) ? "ok" : "MISMATCH");
+	return ns;
+}
+
+int main()
+{
+	//the 12 triangles of a unit cube, scattered as models in front of the camera
+	const glm::vec3 corners[8] = { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+	const int faces[12][3] = { {0,1,2}, {0,2,3}, {4,6,5}, {4,7,6}, {0,4,5}, {0,5,1}, {3,2,6}, {3,6,7}, {0,3,7}, {0,7,4}, {1,5,6}, {1,6,2} };
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> spread(-50.0f, 50.0f), depth(2.0f, 100.0f);
+	std::vector<glm::vec4> worldVertices;
+	worldVertices.reserve(TRIANGLES_CNT * 3);
+	while (worldVertices.size() < TRIANGLES_CNT * 3)
+	{
+		glm::vec3 offset(spread(rng), spread(rng) * 0.2f, -depth(rng));
+		for (int f = 0; f < 12 && worldVertices.size() < TRIANGLES_CNT * 3; f++)
+		{
+			for (int v = 0; v < 3; v++) worldVertices.push_back(glm::vec4(corners[faces[f][v]] + offset, 1.0f));
+		}
+	}
+
+	triangleStream tris;
+	tris.resize(TRIANGLES_CNT);
+	for (size_t t = 0; t < TRIANGLES_CNT; t++)
+	{
+		for (int v = 0; v < 3; v++) tris.set(t, v, worldVertices[t * 3 + v]);
+	}
+
+	glm::vec3 eye(0.0f, 1.0f, 0.0f);
+	glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	glm::mat4 viewMatrix = glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 m = projectionMatrix * viewMatrix;
+
+	clipResult expected;
+	clipTrianglesReference(worldVertices, m, eye, expected);
+
+	printf("%zu triangles, %d iterations, dispatch selects %s\n", TRIANGLES_CNT, ITERATIONS, clipKernel::selectedClipFunctionName());
+	double baseline = measure("reference", [&](clipResult& r) { clipTrianglesReference(worldVertices, m, eye, r); }, expected, 0.0);
+	measure("scalar", [&](clipResult& r) { clipKernel::clipTrianglesScalar(tris, m, eye, r); }, expected, baseline);
+#ifdef CLIP_KERNEL_USE_SIMD
+	measure("SSE", [&](clipResult& r) { clipKernel::clipTrianglesSSE(tris, m, eye, r); }, expected, baseline);
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		measure("AVX2", [&](clipResult& r) { clipKernel::clipTrianglesAVX2(tris, m, eye, r); }, expected, baseline);
+	}
+#endif
+	measure("dispatch", [&](clipResult& r) { clipKernel::clipTriangles(tris, m, eye, r); }, expected, baseline);
+	return 0;
+}